@@ -0,0 +1,234 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include "automat.hpp"
+#include "presets.hpp"
+
+/// @brief Preset measured by the benchmark
+struct Preset {
+	std::string name;
+	std::string defs;
+	std::string rules;
+};
+
+/// @brief Options of the benchmark
+struct Options {
+	std::vector<std::string> presets{ "gol", "ww", "bb" };
+	std::vector<size_t> sizes{ 30, 128, 512, 2048, 8192, 16384 };
+	std::vector<double> densities{ 0.1, 0.3, 0.5 };
+	std::vector<bool> edges{ true, false };
+	std::vector<size_t> threads{ 1 };
+	std::vector<bool> tracking{ true, false };
+	/// @brief maximum amount of generations of one measurement
+	unsigned long long generations = 100;
+	/// @brief cell updates of one measurement, larger grids run less generations
+	double budget = 1 << 28;
+	/// @brief seed of the initial grids
+	unsigned long long seed = 1;
+};
+
+const char* USAGE =
+	"Usage: celat_bench [options]\n"
+	"  --presets LIST        presets to measure, subset of gol,ww,bb (default all)\n"
+	"  --sizes LIST          side lengths of square grids (default 30,128,512,2048,8192,16384)\n"
+	"  --densities LIST      fraction of cells not in the first state (default 0.1,0.3,0.5)\n"
+	"  --edges LIST          wrap,fixed (default both)\n"
+	"  --threads LIST        amounts of threads (default 1)\n"
+	"  --tracking LIST       on,off active tile tracking (default both)\n"
+	"  --generations N       maximum generations per measurement (default 100)\n"
+	"  --budget N            cell updates per measurement (default 268435456)\n"
+	"  --seed N              seed of the initial grids (default 1)\n"
+	"Results are written to standard output as CSV.\n";
+
+/// @brief Parse comma separated list
+/// @tparam T type of the items
+/// @param text list
+/// @param convert conversion of one item, throws on invalid item
+/// @return items
+template<typename T>
+std::vector<T> parseList(const std::string& text, const std::function<T(const std::string&)>& convert) {
+	std::vector<T> items;
+	for (const std::string& item : Automat::splitByDelim(text, ',')) {
+		if (!item.empty()) items.push_back(convert(item));
+	}
+	if (items.empty()) throw std::invalid_argument(text);
+	return items;
+}
+
+/// @brief Parse on/off style switch
+/// @param text item
+/// @param on text meaning true
+/// @param off text meaning false
+/// @return value of the switch
+bool parseSwitch(const std::string& text, const std::string& on, const std::string& off) {
+	if (text == on) return true;
+	if (text == off) return false;
+	throw std::invalid_argument(text);
+}
+
+/// @brief Parse command line arguments
+/// @param argc amount of arguments
+/// @param argv arguments
+/// @param options parsed options
+/// @return std::pair (success, error_message)
+std::pair<bool, std::string> parseOptions(const int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") return { false, "" };
+		if (i + 1 >= argc) return { false, "Missing value of " + arg };
+		std::string text = argv[++i];
+		try {
+			if (arg == "--presets") {
+				options.presets = parseList<std::string>(text, [](const std::string& s) {
+					if (s != "gol" && s != "ww" && s != "bb") throw std::invalid_argument(s);
+					return s;
+				});
+			}
+			else if (arg == "--sizes") {
+				options.sizes = parseList<size_t>(text, [](const std::string& s) {
+					size_t size = std::stoul(s);
+					if (size == 0) throw std::invalid_argument(s);
+					return size;
+				});
+			}
+			else if (arg == "--densities") {
+				options.densities = parseList<double>(text, [](const std::string& s) {
+					double density = std::stod(s);
+					if (density < 0 || density > 1) throw std::invalid_argument(s);
+					return density;
+				});
+			}
+			else if (arg == "--edges") {
+				options.edges = parseList<bool>(text, [](const std::string& s) { return parseSwitch(s, "wrap", "fixed"); });
+			}
+			else if (arg == "--threads") {
+				options.threads = parseList<size_t>(text, [](const std::string& s) { return std::max<size_t>(1, std::stoul(s)); });
+			}
+			else if (arg == "--tracking") {
+				options.tracking = parseList<bool>(text, [](const std::string& s) { return parseSwitch(s, "on", "off"); });
+			}
+			else if (arg == "--generations") options.generations = std::max<unsigned long long>(1, std::stoull(text));
+			else if (arg == "--budget") options.budget = std::stod(text);
+			else if (arg == "--seed") options.seed = std::stoull(text);
+			else return { false, "Unknown option " + arg };
+		}
+		catch (const std::exception&) {
+			return { false, "Invalid value of " + arg };
+		}
+	}
+	return { true, "" };
+}
+
+/// @brief Preset definitions by name
+Preset getPreset(const std::string& name) {
+	if (name == "ww") return { name, Presets::WW_defs, Presets::WW_rules };
+	if (name == "bb") return { name, Presets::BB_defs, Presets::BB_rules };
+	return { name, Presets::GOL_defs, Presets::GOL_rules };
+}
+
+/// @brief Fill grid reproducibly, cells not in the first state get uniformly chosen other state
+/// @param automat automat to fill
+/// @param density fraction of cells not in the first state
+/// @param seed seed of the generator
+void fillRandom(Automat& automat, const double density, const unsigned long long seed) {
+	std::mt19937_64 gen(seed);
+	std::bernoulli_distribution occupied(density);
+	std::uniform_int_distribution<size_t> state(1, automat.getCellTypes().size() - 1);
+	automat.clearCells();
+	for (size_t y = 0; y < automat.height; y++) {
+		for (size_t x = 0; x < automat.width; x++) {
+			if (occupied(gen)) automat.setCellTypeAt(x, y, state(gen));
+		}
+	}
+}
+
+/// @brief Measure run time of an operation repeated count times
+/// @param count amount of repetitions
+/// @param operation measured operation
+/// @return seconds
+double measure(const unsigned long long count, const std::function<void()>& operation) {
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long long i = 0; i < count; i++) operation();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Write one CSV row
+/// @param operation name of the measured operation
+/// @param preset name of the preset
+/// @param size side length of the grid
+/// @param density density of the initial grid, negative if not applicable
+/// @param overflowEdges wrap around borders
+/// @param threads amount of threads
+/// @param tracking active tile tracking
+/// @param count amount of repetitions
+/// @param seconds total run time
+void report(const std::string& operation, const std::string& preset, const size_t size, const double density,
+	const bool overflowEdges, const size_t threads, const bool tracking, const unsigned long long count, const double seconds) {
+	double cells = static_cast<double>(size) * static_cast<double>(size) * static_cast<double>(count);
+	std::cout << operation << ',' << preset << ',' << size << ',' << size << ',';
+	if (density >= 0) std::cout << density;
+	std::cout << ',' << (overflowEdges ? "wrap" : "fixed") << ',' << threads << ',' << (tracking ? "on" : "off") << ','
+		<< count << ',' << seconds << ',' << (seconds > 0 ? cells / seconds : 0) << ','
+		<< (cells > 0 ? seconds * 1e9 / cells : 0) << std::endl;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	auto [parsed, parseError] = parseOptions(argc, argv, options);
+	if (!parsed) {
+		if (!parseError.empty()) std::cerr << parseError << "\n";
+		std::cerr << USAGE;
+		return 1;
+	}
+
+	std::cout << "operation,preset,width,height,density,edges,threads,tracking,iterations,seconds,cells_per_sec,ns_per_cell" << std::endl;
+	try {
+		for (const std::string& presetName : options.presets) {
+			Preset preset = getPreset(presetName);
+			for (size_t size : options.sizes) {
+				//amount of repetitions such that one measurement does about budget cell updates
+				double cells = static_cast<double>(size) * static_cast<double>(size);
+				unsigned long long repeats = static_cast<unsigned long long>(std::max(1.0, std::min(static_cast<double>(options.generations), options.budget / cells)));
+				for (bool overflowEdges : options.edges) {
+					//construction includes parsing of definitions and rules and allocation of the grid
+					double constructSeconds = measure(1, [&]() {
+						Automat automat(size, size, preset.defs, preset.rules, overflowEdges);
+					});
+					report("construct", preset.name, size, -1, overflowEdges, 1, true, 1, constructSeconds);
+
+					Automat automat(size, size, preset.defs, preset.rules, overflowEdges);
+					report("randomize", preset.name, size, -1, overflowEdges, 1, true, repeats,
+						measure(repeats, [&]() { automat.randomizeCells(options.seed); }));
+					report("clear", preset.name, size, -1, overflowEdges, 1, true, repeats,
+						measure(repeats, [&]() { automat.clearCells(); }));
+
+					for (size_t threads : options.threads) {
+						automat.setThreadCount(threads);
+						for (bool tracking : options.tracking) {
+							automat.setActiveTracking(tracking);
+							for (double density : options.densities) {
+								fillRandom(automat, density, options.seed);
+								report("evolve", preset.name, size, density, overflowEdges, threads, tracking, repeats,
+									measure(repeats, [&]() { automat.doOneEvolution(); }));
+								fillRandom(automat, density, options.seed);
+								report("evolve_batch", preset.name, size, density, overflowEdges, threads, tracking, repeats,
+									measure(1, [&]() { automat.doEvolutions(repeats); }));
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	catch (const Automat::InvalidFormatException& e) {
+		std::cerr << "Format error: " << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,521 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#include "automat.hpp"
+#include "presets.hpp"
+#include "rle.hpp"
+#include "chunkedworld.hpp"
+#include "distributed.hpp"
+#include "halotransport.hpp"
+
+/// @brief Options of the runner
+struct Options {
+	std::string preset = "gol";
+	std::string defsFile;
+	std::string rulesFile;
+	std::string inputFile;
+	std::string outputFile;
+	std::string loadFile;
+	std::string saveFile;
+	bool compress = false;
+	size_t width = 0;
+	size_t height = 0;
+	unsigned long long generations = 100;
+	bool overflowEdges = true;
+	bool unbounded = false;
+	bool detectCycles = false;
+	bool population = false;
+	Neighbourhood neighbourhood;
+	bool randomize = false;
+	bool seeded = false;
+	uint64_t seed = 0;
+	size_t threads = 1;
+	size_t processes = 1;
+};
+
+const char* USAGE =
+	"Usage: celat_cli [options]\n"
+	"  --preset gol|ww|bb    use preset cell definitions and rules (default gol)\n"
+	"  --defs FILE           read cell definitions from file\n"
+	"  --rules FILE          read rules from file\n"
+	"  --input FILE          read initial grid from file\n"
+	"  --output FILE         write final grid to file\n"
+	"  --load FILE           start from binary snapshot, replaces grid, definitions and rules options\n"
+	"  --save FILE           write final grid into binary snapshot\n"
+	"  --compress            run length encode cells of the snapshot\n"
+	"  --width N             width of the grid (default width of input or 256)\n"
+	"  --height N            height of the grid (default height of input or 256)\n"
+	"  --generations N       amount of generations to run (default 100)\n"
+	"  --random              randomize the grid before running\n"
+	"  --seed N              seed of --random, the same seed gives the same grid (default random)\n"
+	"  --no-wrap             fixed borders instead of wrapping around\n"
+	"  --neighbourhood T,R   MOORE, VONNEUMANN or HEX with radius R, used when the rules don't choose one (default MOORE,1)\n"
+	"  --unbounded           run on an unbounded grid, the grid written afterwards is the region of live cells\n"
+	"  --detect-cycles       report the period once the grid repeats and skip whole periods of the remaining generations\n"
+	"  --population          print the amount of cells of each type after running\n"
+	"  --threads N           amount of threads (default 1)\n"
+	"  --processes N         split the grid among N processes exchanging edges each generation, each holding and evolving only its part on one thread\n"
+	"GRID FORMAT: one line per row, '.' is the first cell type, 'A' to 'Z' the following ones\n"
+	"Files ending with .rle are read and written as run length encoded patterns\n";
+
+/// @brief true if path names a run length encoded pattern
+bool isRle(const std::string& path) {
+	return path.size() >= 4 && path.compare(path.size() - 4, 4, ".rle") == 0;
+}
+
+/// @brief Read whole file into string
+/// @param path path to the file
+/// @return std::pair (success, content)
+std::pair<bool, std::string> readFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return { false, "" };
+	std::stringstream content;
+	content << file.rdbuf();
+	return { true, content.str() };
+}
+
+/// @brief Convert cell type index into grid character
+/// @param state cell type index, at most 26
+/// @return '.' for the first type, letters for the following ones
+char stateToChar(const size_t state) {
+	if (state == 0) return '.';
+	return static_cast<char>('A' + state - 1);
+}
+
+/// @brief Convert grid character into cell type index
+/// @param c grid character
+/// @return std::pair (success, index)
+std::pair<bool, size_t> charToState(const char c) {
+	if (c == '.') return { true, 0 };
+	if (c >= 'A' && c <= 'Z') return { true, static_cast<size_t>(c - 'A') + 1 };
+	return { false, 0 };
+}
+
+/// @brief Parse command line arguments
+/// @param argc amount of arguments
+/// @param argv arguments
+/// @param options parsed options
+/// @return std::pair (success, error_message)
+std::pair<bool, std::string> parseOptions(const int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		//options with a value
+		auto value = [&]() -> std::pair<bool, std::string> {
+			if (i + 1 >= argc) return { false, "" };
+			return { true, argv[++i] };
+		};
+		try {
+			if (arg == "--random") options.randomize = true;
+			else if (arg == "--no-wrap") options.overflowEdges = false;
+			else if (arg == "--compress") options.compress = true;
+			else if (arg == "--unbounded") options.unbounded = true;
+			else if (arg == "--detect-cycles") options.detectCycles = true;
+			else if (arg == "--population") options.population = true;
+			else if (arg == "--help" || arg == "-h") return { false, "" };
+			else {
+				auto [exists, text] = value();
+				if (!exists) return { false, "Missing value of " + arg };
+				if (arg == "--preset") options.preset = text;
+				else if (arg == "--defs") options.defsFile = text;
+				else if (arg == "--rules") options.rulesFile = text;
+				else if (arg == "--input") options.inputFile = text;
+				else if (arg == "--output") options.outputFile = text;
+				else if (arg == "--load") options.loadFile = text;
+				else if (arg == "--save") options.saveFile = text;
+				else if (arg == "--width") options.width = std::stoul(text);
+				else if (arg == "--height") options.height = std::stoul(text);
+				else if (arg == "--generations") options.generations = std::stoull(text);
+				else if (arg == "--threads") options.threads = std::stoul(text);
+				else if (arg == "--processes") options.processes = std::max<size_t>(std::stoul(text), 1);
+				else if (arg == "--neighbourhood") {
+					auto [valid, neighbourhood] = Neighbourhood::parse(text);
+					if (!valid) return { false, "Invalid value of " + arg };
+					options.neighbourhood = neighbourhood;
+				}
+				else if (arg == "--seed") {
+					options.seed = std::stoull(text);
+					options.seeded = true;
+				}
+				else return { false, "Unknown option " + arg };
+			}
+		}
+		catch (const std::exception&) {
+			return { false, "Invalid value of " + arg };
+		}
+	}
+	if (options.defsFile.empty() != options.rulesFile.empty()) return { false, "--defs and --rules have to be used together" };
+	if (!options.loadFile.empty() && !options.inputFile.empty()) return { false, "--load and --input can't be used together" };
+	if (options.unbounded && options.detectCycles) return { false, "--unbounded and --detect-cycles can't be used together" };
+	if (options.processes > 1 && options.unbounded) return { false, "--processes and --unbounded can't be used together" };
+	if (options.processes > 1 && options.detectCycles) return { false, "--processes and --detect-cycles can't be used together" };
+	if (options.processes > 1 && (!options.loadFile.empty() || !options.saveFile.empty())) return { false, "--processes can't be used with --load or --save" };
+	return { true, "" };
+}
+
+/// @brief Find size of grid file without holding it, trailing empty lines are not rows
+/// @param path path to the file
+/// @param width length of the longest row
+/// @param height amount of rows
+/// @return success
+bool measureGrid(const std::string& path, size_t& width, size_t& height) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+	width = 0;
+	height = 0;
+	size_t y = 0;
+	for (std::string row; std::getline(file, row); y++) {
+		if (!row.empty() && row.back() == '\r') row.pop_back();
+		if (row.empty()) continue;
+		width = std::max(width, row.size());
+		height = y + 1;
+	}
+	return true;
+}
+
+/// @brief Read grid file row by row and pass runs of equal cells, cells outside of the grid are ignored
+/// @param path path to the file
+/// @param typeCount amount of cell types
+/// @param width width of the grid
+/// @param height height of the grid
+/// @param setRun receiver of the runs
+/// @return std::pair (success, error_message)
+std::pair<bool, std::string> loadGrid(const std::string& path, const size_t typeCount, const size_t width, const size_t height,
+	const RlePattern::RunSetter& setRun) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return { false, "Can't read " + path };
+	size_t y = 0;
+	for (std::string row; y < height && std::getline(file, row); y++) {
+		if (!row.empty() && row.back() == '\r') row.pop_back();
+		const size_t end = std::min(row.size(), width);
+		size_t x = 0;
+		while (x < end) {
+			auto [valid, state] = charToState(row[x]);
+			if (!valid || state >= typeCount) {
+				return { false, "Invalid cell '" + std::string(1, row[x]) + "' at row " + std::to_string(y + 1) };
+			}
+			size_t next = x + 1;
+			while (next < end && row[next] == row[x]) next++;
+			setRun(x, y, next - x, state);
+			x = next;
+		}
+	}
+	return { true, "" };
+}
+
+/// @brief Convert cell types of a row into a line of the grid file
+/// @param row cell type of each cell, at most 26
+/// @param line the line without line break
+void gridLine(const std::vector<size_t>& row, std::string& line) {
+	line.resize(row.size());
+	for (size_t x = 0; x < row.size(); x++) line[x] = stateToChar(row[x]);
+}
+
+/// @brief Write cells of automat into grid file
+/// @param automat automat to write
+/// @param path path to the file
+/// @return std::pair (success, error_message)
+std::pair<bool, std::string> writeGrid(const Automat& automat, const std::string& path) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return { false, "Can't open " + path };
+	std::vector<size_t> row(automat.width);
+	std::string line;
+	for (size_t y = 0; y < automat.height; y++) {
+		for (size_t x = 0; x < automat.width; x++) row[x] = automat.getCellTypeAt(x, y);
+		gridLine(row, line);
+		file << line << '\n';
+	}
+	if (!file) return { false, "Can't write " + path };
+	return { true, "" };
+}
+
+/// @brief Print amount of cells of each type
+/// @param cellTypes the cell types
+/// @param population amount of cells of each type
+void printPopulation(const std::vector<CellType>& cellTypes, const std::vector<uint64_t>& population) {
+	std::cout << "population:";
+	for (size_t type = 0; type < population.size(); type++) {
+		std::cout << " " << cellTypes[type].name << "=" << population[type];
+	}
+	std::cout << "\n";
+}
+
+/// @brief Print size of the grid and throughput
+/// @param width width of the initial grid
+/// @param height height of the initial grid
+/// @param generations amount of generations run
+/// @param seconds time of the run
+/// @param evolvedCells amount of cells evolved in all generations
+void printStatistics(const size_t width, const size_t height, const unsigned long long generations,
+	const double seconds, const double evolvedCells) {
+	std::cout << "grid: " << width << "x" << height << "\n";
+	std::cout << "generations: " << generations << "\n";
+	std::cout << "time: " << seconds << " s\n";
+	if (seconds > 0) {
+		std::cout << "generations/s: " << generations / seconds << "\n";
+		std::cout << "cells/s: " << evolvedCells / seconds << "\n";
+	}
+}
+
+/// @brief Run grid split among processes, every process builds only its own region and the output is written row by row,
+/// so no process holds the whole grid
+/// @param options options with the size of the grid and a seed if it is randomized
+/// @param defs cell definitions
+/// @param rules rules
+/// @return exit code
+int runDistributed(const Options& options, const std::string& defs, const std::string& rules) {
+	//grid of the automat is not used, the smallest one keeps it cheap
+	const Automat automat(1, 1, defs, rules, options.overflowEdges, options.neighbourhood);
+	const std::vector<CellType>& cellTypes = automat.getCellTypes();
+	if (!DistributedGrid::chooseLayout(options.width, options.height, automat.getNeighbourhood().radius, options.processes).first) {
+		std::cerr << "Grid is too small to be split among " << options.processes << " processes\n";
+		return 1;
+	}
+	if (!options.outputFile.empty() && !isRle(options.outputFile) && cellTypes.size() > 27) {
+		std::cerr << "Grid format supports at most 27 cell types\n";
+		return 1;
+	}
+	//every process continues from here, only the first one reports
+	SocketTransport transport;
+	auto [started, startError] = transport.start(options.processes);
+	if (!started) {
+		std::cerr << startError << "\n";
+		return 1;
+	}
+	const bool first = transport.getRank() == 0;
+	DistributedGrid grid(automat, options.width, options.height, transport);
+
+	//every process reads the whole input and keeps the cells of its region
+	auto setRun = [&grid](const size_t x, const size_t y, const size_t length, const size_t type) {
+		grid.setCellRun(x, y, length, type);
+	};
+	std::pair<bool, std::string> loaded{ true, "" };
+	if (isRle(options.inputFile)) {
+		std::ifstream pattern(options.inputFile, std::ios::binary);
+		loaded = RlePattern::read(pattern, cellTypes, options.width, options.height, 0, 0, setRun);
+	}
+	else if (!options.inputFile.empty()) loaded = loadGrid(options.inputFile, cellTypes.size(), options.width, options.height, setRun);
+	if (!loaded.first) {
+		//all processes read the same input and fail together
+		if (!first) return 1;
+		std::cerr << loaded.second << "\n";
+		transport.join();
+		return 1;
+	}
+	if (options.randomize) grid.randomizeCells(options.seed);
+
+	auto start = std::chrono::steady_clock::now();
+	grid.doEvolutions(options.generations);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::vector<uint64_t> population;
+	if (options.population) population = grid.gatherPopulation();
+
+	//rows arrive at the first process one by one and are written straight away
+	std::pair<bool, std::string> written{ true, "" };
+	if (!options.outputFile.empty()) {
+		std::ofstream output;
+		if (first) output.open(options.outputFile, std::ios::binary);
+		if (isRle(options.outputFile)) {
+			RlePattern::Writer writer(output);
+			if (first) written = writer.writeHeader(automat, options.width, options.height);
+			grid.gather([&writer, &written](const std::vector<size_t>& row) {
+				if (written.first) writer.writeRow(row);
+			});
+			if (first && written.first) written = writer.finish();
+		}
+		else {
+			std::string line;
+			grid.gather([&output, &line](const std::vector<size_t>& row) {
+				gridLine(row, line);
+				output << line << '\n';
+			});
+			if (first && !output) written = { false, "Can't write " + options.outputFile };
+		}
+	}
+	if (!first) return 0;
+
+	auto [joined, joinError] = transport.join();
+	if (!joined) {
+		std::cerr << joinError << "\n";
+		return 1;
+	}
+	if (!written.first) {
+		std::cerr << written.second << "\n";
+		return 1;
+	}
+	auto [columns, rows] = grid.getLayout();
+	std::cout << "processes: " << options.processes << " (" << columns << "x" << rows << ")\n";
+	if (options.population) printPopulation(cellTypes, population);
+	const double evolvedCells = static_cast<double>(options.width) * static_cast<double>(options.height) * static_cast<double>(options.generations);
+	printStatistics(options.width, options.height, options.generations, seconds, evolvedCells);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	auto [parsed, parseError] = parseOptions(argc, argv, options);
+	if (!parsed) {
+		if (!parseError.empty()) std::cerr << parseError << "\n";
+		std::cerr << USAGE;
+		return 1;
+	}
+
+	//cell definitions and rules
+	std::string defs;
+	std::string rules;
+	if (!options.defsFile.empty()) {
+		auto [defsRead, defsText] = readFile(options.defsFile);
+		auto [rulesRead, rulesText] = readFile(options.rulesFile);
+		if (!defsRead || !rulesRead) {
+			std::cerr << "Can't read " << (defsRead ? options.rulesFile : options.defsFile) << "\n";
+			return 1;
+		}
+		defs = defsText;
+		rules = rulesText;
+	}
+	else if (options.preset == "gol") {
+		defs = Presets::GOL_defs;
+		rules = Presets::GOL_rules;
+	}
+	else if (options.preset == "ww") {
+		defs = Presets::WW_defs;
+		rules = Presets::WW_rules;
+	}
+	else if (options.preset == "bb") {
+		defs = Presets::BB_defs;
+		rules = Presets::BB_rules;
+	}
+	else {
+		std::cerr << "Unknown preset " << options.preset << "\n";
+		return 1;
+	}
+
+	//initial grid decides the size unless it is given
+	if (isRle(options.inputFile)) {
+		std::ifstream input(options.inputFile, std::ios::binary);
+		RleHeader header;
+		auto [headerRead, headerError] = input ? RlePattern::readHeader(input, header) : std::make_pair(false, "Can't read " + options.inputFile);
+		if (!headerRead) {
+			std::cerr << headerError << "\n";
+			return 1;
+		}
+		if (options.width == 0) options.width = header.width;
+		if (options.height == 0) options.height = header.height;
+	}
+	else if (!options.inputFile.empty()) {
+		size_t inputWidth = 0;
+		size_t inputHeight = 0;
+		if (!measureGrid(options.inputFile, inputWidth, inputHeight)) {
+			std::cerr << "Can't read " << options.inputFile << "\n";
+			return 1;
+		}
+		if (options.width == 0) options.width = inputWidth;
+		if (options.height == 0) options.height = inputHeight;
+	}
+	if (options.width == 0) options.width = 256;
+	if (options.height == 0) options.height = 256;
+	//processes have to draw the same grid
+	if (options.randomize && !options.seeded) {
+		std::random_device rd;
+		options.seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+		options.seeded = true;
+	}
+
+	try {
+		if (options.processes > 1) return runDistributed(options, defs, rules);
+		//snapshot brings its own definitions, rules and size
+		Automat automat = options.loadFile.empty()
+			? Automat(options.width, options.height, defs, rules, options.overflowEdges, options.neighbourhood)
+			: Automat::loadSnapshot(options.loadFile);
+		automat.setThreadCount(options.threads);
+		//grids are decoded straight into the automat while reading the file
+		std::pair<bool, std::string> loaded{ true, "" };
+		if (isRle(options.inputFile)) {
+			std::ifstream pattern(options.inputFile, std::ios::binary);
+			loaded = RlePattern::read(pattern, automat, 0, 0);
+		}
+		else if (!options.inputFile.empty()) {
+			loaded = loadGrid(options.inputFile, automat.getCellTypes().size(), automat.width, automat.height,
+				[&automat](const size_t x, const size_t y, const size_t length, const size_t type) { automat.setCellRun(x, y, length, type); });
+		}
+		if (!loaded.first) {
+			std::cerr << loaded.second << "\n";
+			return 1;
+		}
+		if (options.randomize) automat.randomizeCells(options.seed);
+
+		//hashing and counting start from the initial grid, outside of the measured time
+		if (!options.unbounded) {
+			automat.setCycleDetection(options.detectCycles);
+			automat.setPopulationCounting(options.population);
+		}
+		//the unbounded run replaces the grid by the region of its cells, throughput refers to the cells evolved
+		const size_t gridWidth = automat.width;
+		const size_t gridHeight = automat.height;
+		double evolvedCells = static_cast<double>(gridWidth) * static_cast<double>(gridHeight) * static_cast<double>(options.generations);
+		auto start = std::chrono::steady_clock::now();
+		double seconds = 0;
+		if (options.unbounded) {
+			ChunkedWorld world(automat);
+			world.setThreadCount(options.threads);
+			world.doEvolutions(options.generations);
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			evolvedCells = static_cast<double>(world.getEvaluatedChunks()) * ChunkedWorld::CHUNK_SIZE * ChunkedWorld::CHUNK_SIZE;
+			//the region of cells other than the first type replaces the grid
+			auto [occupied, bounds] = world.getBounds();
+			Automat region(std::max<size_t>(bounds.width, 1), std::max<size_t>(bounds.height, 1),
+				automat.getCellDefinitions(), automat.getRulesDefinitions(), false);
+			if (occupied) world.writeTo(region, bounds.x, bounds.y);
+			automat = std::move(region);
+			std::cout << "chunks: " << world.getChunkCount() << "\n";
+			std::cout << "origin: " << bounds.x << "," << bounds.y << "\n";
+		}
+		else {
+			automat.doEvolutions(options.generations);
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			auto [repeats, period] = automat.getCyclePeriod();
+			if (repeats) std::cout << "period: " << period << "\n";
+		}
+		if (options.population) printPopulation(automat.getCellTypes(), automat.getPopulation());
+
+		if (isRle(options.outputFile)) {
+			std::ofstream output(options.outputFile, std::ios::binary);
+			auto [written, writeError] = RlePattern::write(output, automat, 0, 0, automat.width, automat.height);
+			if (!written) {
+				std::cerr << writeError << "\n";
+				return 1;
+			}
+		}
+		else if (!options.outputFile.empty()) {
+			if (automat.getCellTypes().size() > 27) {
+				std::cerr << "Grid format supports at most 27 cell types\n";
+				return 1;
+			}
+			auto [written, writeError] = writeGrid(automat, options.outputFile);
+			if (!written) {
+				std::cerr << writeError << "\n";
+				return 1;
+			}
+		}
+		if (!options.saveFile.empty()) automat.saveSnapshot(options.saveFile, options.compress);
+
+		printStatistics(gridWidth, gridHeight, options.generations, seconds, evolvedCells);
+	}
+	catch (const Automat::InvalidFormatException& e) {
+		std::cerr << "Format error: " << e.what() << "\n";
+		return 1;
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << "Error: " << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
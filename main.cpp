@@ -1,10 +1,21 @@
+#include <vector>
+#include <memory>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+
 #include "wx/wx.h"
 
 #include "src/automat.hpp"
 #include "src/presets.hpp"
+#include "src/simulation.hpp"
+#include "src/rle.hpp"
 
 constexpr size_t CELL_WIDTH = 20;
 constexpr size_t GRID_WIDTH = 30;
+//time between repaints in milliseconds
+constexpr int DISPLAY_INTERVAL = 30;
 
 //IDs for wxWidgets objects
 enum class IDs {
@@ -19,24 +30,31 @@ enum class IDs {
     start,
     preset_bb,
     randomize,
-    board_size_btn
+    board_size_btn,
+    speed,
+    save_snapshot,
+    load_snapshot,
+    import_pattern,
+    export_pattern
 };
 
 //class drawing automat grid on the GUI
 class DrawPane : public wxPanel
 {
 private:
+    /// @brief sequence number of the last painted frame
+    unsigned long long paintedSequence = 0;
 
 public:
-    Automat* automat;
+    Simulation* simulation;
 
     /// @brief DrawPane constructor
     /// @param parent parent of the panel
     /// @param size size of the panel
-    /// @param automat pointer to the automat
-    DrawPane(wxFrame* parent, wxSize size, Automat *automat) :
+    /// @param simulation simulation publishing frames to draw
+    DrawPane(wxFrame* parent, wxSize size, Simulation* simulation) :
         wxPanel(parent, (int)IDs::default_id, wxDefaultPosition, size),
-        automat(automat) {
+        simulation(simulation) {
     }
 
     //events for drawing
@@ -51,14 +69,18 @@ public:
         render(dc);
     }
 
-    void paintCellAt(int rowCell, int colCell) {
+    /// @brief paint the newest frame of the simulation if there is one
+    void paintFrame() {
+        if (!simulation->updateFrame()) return;
         wxClientDC dc(this);
-        renderAt(dc, rowCell, colCell);
+        renderFrame(dc);
     }
 
     void render(wxDC& dc);
 
-    void renderAt(wxDC& dc, int rowCell, int colCell);
+    void renderFrame(wxDC& dc);
+
+    void renderRegion(wxDC& dc, const Frame& frame, const CellRegion& region);
 
     void mouseDown(wxMouseEvent& event);
  
@@ -106,16 +128,32 @@ private:
     wxButton* btnClear;
     wxButton* btnRandom;
 
+    wxButton* btnSaveSnapshot;
+    wxButton* btnLoadSnapshot;
+
+    wxButton* btnImportPattern;
+    wxButton* btnExportPattern;
+
     wxBoxSizer* sizer;
     wxBoxSizer* sizerCtrlBtns;
     wxBoxSizer* sizerBoardSize;
     wxBoxSizer* sizerSetHelp;
     wxBoxSizer* sizerPresets;
     wxBoxSizer* sizerBoardControl;
+    wxBoxSizer* sizerSnapshot;
+    wxBoxSizer* sizerPattern;
     wxFlexGridSizer* controlsSizer;
 
     wxTimer* timer;
 
+    /// @brief automat evolving on its own thread
+    std::unique_ptr<Simulation> simulation;
+    /// @brief width and height of the board
+    size_t boardSize;
+
+    /// @brief stop continuous evolution and update start button
+    void pauseSimulation();
+
     void createUIElements(const std::string& cellDefinitions, const std::string& rulesDefinitions);
     void createSizers();
     void populateSizers();
@@ -126,6 +164,7 @@ public:
     /// @param pos position of the frame
     /// @param size size of the frame
     MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size, const int newSize);
+    ~MainFrame();
     //event functions
     void oneStepBtnEvent(wxCommandEvent& event);
     void setRulesBtnEvent(wxCommandEvent& event);
@@ -134,8 +173,13 @@ public:
     void clearCells(wxCommandEvent& event);
     void loadPreset(wxCommandEvent& event);
     void onTimer(wxTimerEvent& event);
-    void timerStartStop(wxCommandEvent& event);
+    void startStop(wxCommandEvent& event);
     void randomizeCells(wxCommandEvent& event);
+    void speedChanged(wxCommandEvent& event);
+    void saveSnapshot(wxCommandEvent& event);
+    void loadSnapshot(wxCommandEvent& event);
+    void importPattern(wxCommandEvent& event);
+    void exportPattern(wxCommandEvent& event);
 
     DECLARE_EVENT_TABLE()
 };
@@ -176,13 +220,20 @@ void MainFrame::createUIElements(const std::string& cellDefinitions, const std::
     btnPresetBB = new wxButton(this, (int)IDs::preset_bb, wxString("BRIAN'S BRAIN"));
 
     speedTxt = new wxStaticText(this, (int)IDs::default_id, wxString("SIMULATION SPEED"));
-    speedSlider = new wxSlider(this, (int)IDs::default_id, 500, 100, 1000, wxDefaultPosition, wxSize(200, -1), wxSL_HORIZONTAL);
+    //milliseconds between generations, 0 runs as fast as possible
+    speedSlider = new wxSlider(this, (int)IDs::speed, 500, 0, 1000, wxDefaultPosition, wxSize(200, -1), wxSL_HORIZONTAL);
 
     btnStart = new wxButton(this, (int)IDs::start, wxString("START"));
     btnOneStep = new wxButton(this, (int)IDs::next_step, wxString("ONE STEP"));
 
     btnRandom = new wxButton(this, (int)IDs::randomize, wxString("RANDOMIZE BOARD"));
     btnClear = new wxButton(this, (int)IDs::clear, wxString("CLEAR"));
+
+    btnSaveSnapshot = new wxButton(this, (int)IDs::save_snapshot, wxString("SAVE SNAPSHOT"));
+    btnLoadSnapshot = new wxButton(this, (int)IDs::load_snapshot, wxString("LOAD SNAPSHOT"));
+
+    btnImportPattern = new wxButton(this, (int)IDs::import_pattern, wxString("IMPORT RLE"));
+    btnExportPattern = new wxButton(this, (int)IDs::export_pattern, wxString("EXPORT RLE"));
 }
 
 void MainFrame::createSizers() {
@@ -193,8 +244,10 @@ void MainFrame::createSizers() {
     sizerPresets = new wxBoxSizer(wxHORIZONTAL);
     sizerBoardControl = new wxBoxSizer(wxHORIZONTAL);
     sizerBoardSize = new wxBoxSizer(wxHORIZONTAL);
+    sizerSnapshot = new wxBoxSizer(wxHORIZONTAL);
+    sizerPattern = new wxBoxSizer(wxHORIZONTAL);
     //main sizer for control panel
-    int rows = 15;
+    int rows = 17;
     int columns = 1;
     int vgap = 10;
     int hgap = 10;
@@ -212,6 +265,12 @@ void MainFrame::populateSizers() {
     sizerBoardControl->Add(btnRandom);
     sizerBoardControl->Add(btnClear);
 
+    sizerSnapshot->Add(btnSaveSnapshot);
+    sizerSnapshot->Add(btnLoadSnapshot);
+
+    sizerPattern->Add(btnImportPattern);
+    sizerPattern->Add(btnExportPattern);
+
     sizerPresets->Add(btnPresetGOL);
     sizerPresets->Add(btnPresetWW);
     sizerPresets->Add(btnPresetBB);
@@ -231,6 +290,8 @@ void MainFrame::populateSizers() {
     controlsSizer->Add(speedSlider);
     controlsSizer->Add(sizerCtrlBtns);
     controlsSizer->Add(sizerBoardControl);
+    controlsSizer->Add(sizerSnapshot);
+    controlsSizer->Add(sizerPattern);
 
     sizer->Add(drawPane, 1);
     sizer->Add(controlsSizer, 1);
@@ -246,11 +307,12 @@ MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& si
     bool overflow = true;
     auto& def_defs = Presets::GOL_defs;
     auto& def_rules = Presets::GOL_rules;
-    Automat* automat = new Automat(newSize, newSize, def_defs, def_rules, overflow);
+    boardSize = newSize;
+    simulation = std::make_unique<Simulation>(std::make_unique<Automat>(boardSize, boardSize, def_defs, def_rules, overflow));
 
     //drawpane
     int gridWidth = (newSize * CELL_WIDTH) + newSize * 2;
-    drawPane = new DrawPane(this, wxSize(gridWidth, gridWidth), automat);
+    drawPane = new DrawPane(this, wxSize(gridWidth, gridWidth), simulation.get());
 
     SetBackgroundColour(*wxLIGHT_GREY);
     
@@ -260,8 +322,17 @@ MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& si
 
     populateSizers();
 
-    //timer for automatic automat looping
+    simulation->setInterval(std::chrono::milliseconds(speedSlider->GetValue()));
+    simulation->setStopOnCycle(true);
+
+    //timer repainting generations published by the simulation
     timer = new wxTimer(this, (int)IDs::timer);
+    timer->Start(DISPLAY_INTERVAL);
+}
+
+MainFrame::~MainFrame() {
+    timer->Stop();
+    delete timer;
 }
 
 void DrawPane::mouseDown(wxMouseEvent& event) {
@@ -270,49 +341,78 @@ void DrawPane::mouseDown(wxMouseEvent& event) {
     int y = event.GetX();
     int rowCell = x / CELL_WIDTH;
     int colCell = y / CELL_WIDTH;
-    if (rowCell >= 0 && colCell >= 0 && rowCell < (int)automat->width && colCell < (int)automat->height) {
-        automat->cellCycleType(rowCell, colCell);
-        paintCellAt(rowCell, colCell);
+    const Frame& frame = simulation->getFrame();
+    if (rowCell >= 0 && colCell >= 0 && rowCell < (int)frame.width && colCell < (int)frame.height) {
+        //change is applied between generations and shows up in the next frame
+        simulation->edit([rowCell, colCell](Automat& automat) { automat.cellCycleType(rowCell, colCell); });
     }
 }
 
 void DrawPane::render(wxDC& dc) {
-    //drawing each cell as a rectangle
-    dc.SetPen(*wxGREY_PEN);
-    for (size_t i = 0; i < automat->height; i++)
-    {
-        for (size_t j = 0; j < automat->width; j++)
-        {
-            wxColor cellColour = wxColor(automat->getColourAt(j, i));
-            dc.SetBrush(wxBrush(cellColour));
-            dc.DrawRectangle(wxRect(wxPoint(i * CELL_WIDTH, j * CELL_WIDTH), wxSize(CELL_WIDTH, CELL_WIDTH)));
-        }
-    } 
+    const Frame& frame = simulation->getFrame();
+    renderRegion(dc, frame, CellRegion{ 0, 0, frame.width, frame.height });
+    paintedSequence = frame.sequence;
+}
+
+void DrawPane::renderFrame(wxDC& dc) {
+    const Frame& frame = simulation->getFrame();
+    //changed regions are relative to the previous frame, everything is repainted if frames were dropped
+    if (paintedSequence == 0 || frame.sequence != paintedSequence + 1) {
+        render(dc);
+        return;
+    }
+    for (const CellRegion& region : frame.changed) {
+        renderRegion(dc, frame, region);
+    }
+    paintedSequence = frame.sequence;
 }
 
-void DrawPane::renderAt(wxDC& dc, int rowCell, int colCell) {
+void DrawPane::renderRegion(wxDC& dc, const Frame& frame, const CellRegion& region) {
+    if (region.width == 0 || region.height == 0) return;
+
+    //automat is using inverted coordinate system, cell (x, y) is drawn in column y and row x
+    wxImage image(region.height, region.width);
+    unsigned char* rgb = image.GetData();
+    for (size_t x = 0; x < region.width; x++) {
+        for (size_t y = 0; y < region.height; y++) {
+            uint32_t colour = frame.pixels[(region.y + y) * frame.width + region.x + x];
+            unsigned char* pixel = rgb + (x * region.height + y) * 3;
+            pixel[0] = (colour >> 24) & 0xFF;
+            pixel[1] = (colour >> 16) & 0xFF;
+            pixel[2] = (colour >> 8) & 0xFF;
+        }
+    }
+
+    //one scaled blit of the whole region
+    int left = region.y * CELL_WIDTH;
+    int top = region.x * CELL_WIDTH;
+    int right = (region.y + region.height) * CELL_WIDTH;
+    int bottom = (region.x + region.width) * CELL_WIDTH;
+    wxBitmap bitmap(image);
+    wxMemoryDC bitmapDC(bitmap);
+    dc.StretchBlit(left, top, right - left, bottom - top, &bitmapDC, 0, 0, region.height, region.width);
+    bitmapDC.SelectObject(wxNullBitmap);
+
+    //cells are separated by grid lines
     dc.SetPen(*wxGREY_PEN);
-    wxColor cellColour = wxColor(automat->getColourAt(rowCell, colCell));
-    dc.SetBrush(wxBrush(cellColour));
-    dc.DrawRectangle(wxRect(wxPoint(colCell * CELL_WIDTH, rowCell * CELL_WIDTH), wxSize(CELL_WIDTH, CELL_WIDTH)));
+    for (int i = left; i <= right; i += CELL_WIDTH) dc.DrawLine(i, top, i, bottom);
+    for (int j = top; j <= bottom; j += CELL_WIDTH) dc.DrawLine(left, j, right, j);
 }
 
 void MainFrame::oneStepBtnEvent(wxCommandEvent& event) {
-    //stop timer, do evolution, redraw
-    if (timer->IsRunning()) timerStartStop(event);
-    drawPane->automat->doOneEvolution();
-    drawPane->paintNow();
+    //stop simulation, do evolution, the frame is painted by the timer
+    pauseSimulation();
+    simulation->step(1);
 }
 
 void MainFrame::setRulesBtnEvent(wxCommandEvent& event) {
-    //stop timer, get new rules, set new automat or display error
-    if (timer->IsRunning()) timerStartStop(event);
+    //stop simulation, get new rules, apply them to the board or display error
+    pauseSimulation();
     std::string newDefs = std::string(this->cellDefTxt->GetValue().mb_str());
     std::string newRules = std::string(this->cellRulesTxt->GetValue().mb_str());
     bool overflow = checkOverFlow->IsChecked();
     try {
-        drawPane->automat = new Automat(drawPane->automat->width, drawPane->automat->height, newDefs, newRules, overflow);
-        drawPane->paintNow();
+        simulation->setRules(newDefs, newRules, overflow);
     }
     catch (const Automat::InvalidFormatException& e) {
         auto error = e.what();
@@ -340,13 +440,12 @@ void MainFrame::displayHelpEvent(wxCommandEvent& event) {
 }
 
 void MainFrame::clearCells(wxCommandEvent& event) {
-    drawPane->automat->clearCells();
-    drawPane->paintNow();
+    simulation->edit([](Automat& automat) { automat.clearCells(); });
 }
 
 void MainFrame::loadPreset(wxCommandEvent& event) {
-    //stop timer, load automaton preset, redraw
-    if (timer->IsRunning()) timerStartStop(event);
+    //stop simulation, load automaton preset
+    pauseSimulation();
     bool overflow = checkOverFlow->IsChecked();
     std::string new_defs;
     std::string new_rules;
@@ -363,36 +462,139 @@ void MainFrame::loadPreset(wxCommandEvent& event) {
         new_defs = Presets::BB_defs;
         new_rules = Presets::BB_rules;
     }
-    drawPane->automat = new Automat(drawPane->automat->width, drawPane->automat->height, new_defs, new_rules, overflow);
+    simulation->setRules(new_defs, new_rules, overflow);
     cellDefTxt->SetValue(new_defs);
     cellRulesTxt->SetValue(new_rules);
-    drawPane->paintNow();
 }
 
 void MainFrame::onTimer(wxTimerEvent& event) {
-    drawPane->automat->doOneEvolution();
-    drawPane->paintNow();
-    if (speedSlider->GetValue() != timer->GetInterval())  timer->Start(speedSlider->GetValue());
+    //generations finished since the last tick are dropped, only the newest one is painted
+    drawPane->paintFrame();
+    //simulation pauses by itself once the grid settled into a still life or oscillator
+    if (btnStart->GetLabel() == "STOP" && simulation->getFrame().period > 0 && !simulation->isRunning()) {
+        btnStart->SetLabel("START");
+    }
 }
 
-void MainFrame::timerStartStop(wxCommandEvent& event) {
-    if (timer->IsRunning()) {
-        timer->Stop();
-        btnStart->SetLabel("START");
+void MainFrame::startStop(wxCommandEvent& event) {
+    if (simulation->isRunning()) {
+        pauseSimulation();
     }
     else {
-        timer->Start(speedSlider->GetValue());
+        simulation->start();
         btnStart->SetLabel("STOP");
     }
 }
 
+void MainFrame::pauseSimulation() {
+    simulation->pause();
+    btnStart->SetLabel("START");
+}
+
+void MainFrame::speedChanged(wxCommandEvent& event) {
+    simulation->setInterval(std::chrono::milliseconds(speedSlider->GetValue()));
+}
+
 void MainFrame::randomizeCells(wxCommandEvent& event) {
-    drawPane->automat->randomizeCells();
-    drawPane->paintNow();
+    simulation->edit([](Automat& automat) { automat.randomizeCells(); });
+}
+
+void MainFrame::saveSnapshot(wxCommandEvent& event) {
+    pauseSimulation();
+    wxFileDialog dialog(this, wxString("Save snapshot"), wxEmptyString, wxEmptyString,
+        wxString("Snapshots (*.celat)|*.celat"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dialog.ShowModal() == wxID_CANCEL) return;
+    std::string path = std::string(dialog.GetPath().mb_str());
+    //automat is only accessed by the simulation thread, the snapshot is written there between generations
+    std::string error;
+    simulation->edit([path, &error](Automat& automat) {
+        try {
+            automat.saveSnapshot(path, true);
+        }
+        catch (const Automat::InvalidFormatException& e) {
+            error = e.what();
+        }
+    });
+    simulation->wait();
+    if (!error.empty()) wxMessageBox(wxString(error), wxString("Snapshot error"), wxICON_ERROR);
+}
+
+void MainFrame::loadSnapshot(wxCommandEvent& event) {
+    pauseSimulation();
+    wxFileDialog dialog(this, wxString("Load snapshot"), wxEmptyString, wxEmptyString,
+        wxString("Snapshots (*.celat)|*.celat"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if (dialog.ShowModal() == wxID_CANCEL) return;
+    std::string path = std::string(dialog.GetPath().mb_str());
+    try {
+        std::unique_ptr<Automat> automat = std::make_unique<Automat>(Automat::loadSnapshot(path));
+        if (automat->width != boardSize || automat->height != boardSize) {
+            wxString message = wxString::Format("Snapshot grid is %zux%zu, set board size to %zu first",
+                automat->width, automat->height, automat->width);
+            wxMessageBox(message, wxString("Snapshot error"), wxICON_ERROR);
+            return;
+        }
+        cellDefTxt->SetValue(automat->getCellDefinitions());
+        cellRulesTxt->SetValue(automat->getRulesDefinitions());
+        checkOverFlow->SetValue(automat->getOverflowEdges());
+        simulation->replace(std::move(automat));
+    }
+    catch (const Automat::InvalidFormatException& e) {
+        wxMessageBox(wxString(e.what()), wxString("Snapshot error"), wxICON_ERROR);
+    }
+}
+
+void MainFrame::importPattern(wxCommandEvent& event) {
+    pauseSimulation();
+    wxFileDialog dialog(this, wxString("Import pattern"), wxEmptyString, wxEmptyString,
+        wxString("RLE patterns (*.rle)|*.rle"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if (dialog.ShowModal() == wxID_CANCEL) return;
+    std::string path = std::string(dialog.GetPath().mb_str());
+    std::ifstream input(path, std::ios::binary);
+    RleHeader header;
+    auto [headerRead, headerError] = RlePattern::readHeader(input, header);
+    if (!headerRead) {
+        wxMessageBox(wxString(headerError), wxString("Pattern error"), wxICON_ERROR);
+        return;
+    }
+    if (header.width > boardSize || header.height > boardSize) {
+        wxString message = wxString::Format("Pattern is %zux%zu, the board is only %zux%zu",
+            header.width, header.height, boardSize, boardSize);
+        wxMessageBox(message, wxString("Pattern error"), wxICON_ERROR);
+        return;
+    }
+    //pattern is placed in the middle of the board, decoded on the simulation thread
+    //board shows the automat's inverted coordinate system, so patterns appear mirrored along the diagonal
+    size_t x = (boardSize - header.width) / 2;
+    size_t y = (boardSize - header.height) / 2;
+    std::string error;
+    simulation->edit([path, x, y, &error](Automat& automat) {
+        std::ifstream pattern(path, std::ios::binary);
+        auto [read, readError] = RlePattern::read(pattern, automat, x, y);
+        if (!read) error = readError;
+    });
+    simulation->wait();
+    if (!error.empty()) wxMessageBox(wxString(error), wxString("Pattern error"), wxICON_ERROR);
+}
+
+void MainFrame::exportPattern(wxCommandEvent& event) {
+    pauseSimulation();
+    wxFileDialog dialog(this, wxString("Export pattern"), wxEmptyString, wxEmptyString,
+        wxString("RLE patterns (*.rle)|*.rle"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dialog.ShowModal() == wxID_CANCEL) return;
+    std::string path = std::string(dialog.GetPath().mb_str());
+    std::string error;
+    simulation->edit([path, &error](Automat& automat) {
+        std::ofstream output(path, std::ios::binary);
+        auto [written, writeError] = RlePattern::write(output, automat, 0, 0, automat.width, automat.height);
+        if (!written) error = writeError;
+    });
+    simulation->wait();
+    if (!error.empty()) wxMessageBox(wxString(error), wxString("Pattern error"), wxICON_ERROR);
 }
 
 void MainFrame::setBoardSize(wxCommandEvent& event) {
     this->timer->Stop();
+    this->simulation->pause();
     int newSize = boardSizeSlider->GetValue();
     int gridWidth = (newSize * CELL_WIDTH) + newSize * 2;
     int gridHeight = (newSize * CELL_WIDTH) + newSize * 2;
@@ -419,8 +621,13 @@ EVT_BUTTON((int)IDs::preset_bb, MainFrame::loadPreset)
 EVT_BUTTON((int)IDs::clear, MainFrame::clearCells)
 EVT_BUTTON((int)IDs::randomize, MainFrame::randomizeCells)
 EVT_TIMER((int)IDs::timer, MainFrame::onTimer)
-EVT_BUTTON((int)IDs::start, MainFrame::timerStartStop)
+EVT_BUTTON((int)IDs::start, MainFrame::startStop)
+EVT_SLIDER((int)IDs::speed, MainFrame::speedChanged)
 EVT_BUTTON((int)IDs::board_size_btn, MainFrame::setBoardSize)
+EVT_BUTTON((int)IDs::save_snapshot, MainFrame::saveSnapshot)
+EVT_BUTTON((int)IDs::load_snapshot, MainFrame::loadSnapshot)
+EVT_BUTTON((int)IDs::import_pattern, MainFrame::importPattern)
+EVT_BUTTON((int)IDs::export_pattern, MainFrame::exportPattern)
 END_EVENT_TABLE()
 //events for DrawPane
 BEGIN_EVENT_TABLE(DrawPane, wxPanel)
@@ -0,0 +1,84 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "activetiles.hpp"
+
+ActiveTiles::ActiveTiles(const size_t width, const size_t height, const size_t tileWidth, const size_t tileHeight, const bool overflowEdges)
+	: width(width),
+	height(height),
+	tileWidth(tileWidth),
+	tileHeight(tileHeight),
+	tilesX((width + tileWidth - 1) / tileWidth),
+	tilesY((height + tileHeight - 1) / tileHeight),
+	overflowEdges(overflowEdges),
+	changed(std::vector<uint8_t>(tilesX * tilesY, 0)),
+	everything(true),
+	dirty(std::vector<uint8_t>(tilesX * tilesY, 0)),
+	allDirty(true)
+{
+}
+
+const std::vector<size_t>& ActiveTiles::collect(const bool all) {
+	active.clear();
+	if (everything || all) {
+		for (size_t tile = 0; tile < size(); tile++) active.push_back(tile);
+		std::fill(changed.begin(), changed.end(), 0);
+		everything = false;
+		return active;
+	}
+
+	//changed tiles and their neighbours, neighbours across borders only when they wrap around
+	std::vector<uint8_t> marked(size(), 0);
+	for (size_t ty = 0; ty < tilesY; ty++) {
+		for (size_t tx = 0; tx < tilesX; tx++) {
+			if (!changed[ty * tilesX + tx]) continue;
+			for (long long dy = -1; dy <= 1; dy++) {
+				long long ny = static_cast<long long>(ty) + dy;
+				if (ny < 0 || ny >= static_cast<long long>(tilesY)) {
+					if (!overflowEdges) continue;
+					ny = (ny + tilesY) % tilesY;
+				}
+				for (long long dx = -1; dx <= 1; dx++) {
+					long long nx = static_cast<long long>(tx) + dx;
+					if (nx < 0 || nx >= static_cast<long long>(tilesX)) {
+						if (!overflowEdges) continue;
+						nx = (nx + tilesX) % tilesX;
+					}
+					marked[static_cast<size_t>(ny) * tilesX + static_cast<size_t>(nx)] = 1;
+				}
+			}
+		}
+	}
+	for (size_t tile = 0; tile < size(); tile++) {
+		if (marked[tile]) active.push_back(tile);
+	}
+	std::fill(changed.begin(), changed.end(), 0);
+	return active;
+}
+
+std::vector<CellRegion> ActiveTiles::takeDirtyRegions() {
+	std::vector<CellRegion> regions;
+	if (allDirty) {
+		if (width > 0 && height > 0) regions.push_back({ 0, 0, width, height });
+	}
+	else {
+		for (size_t ty = 0; ty < tilesY; ty++) {
+			const size_t firstRow = ty * tileHeight;
+			const size_t rows = std::min(tileHeight, height - firstRow);
+			for (size_t tx = 0; tx < tilesX; tx++) {
+				if (!dirty[ty * tilesX + tx]) continue;
+				const size_t firstColumn = tx * tileWidth;
+				//run of dirty tiles in the row becomes one region
+				size_t last = tx;
+				while (last + 1 < tilesX && dirty[ty * tilesX + last + 1]) last++;
+				const size_t lastColumn = std::min((last + 1) * tileWidth, width);
+				regions.push_back({ firstColumn, firstRow, lastColumn - firstColumn, rows });
+				tx = last;
+			}
+		}
+	}
+	std::fill(dirty.begin(), dirty.end(), 0);
+	allDirty = false;
+	return regions;
+}
@@ -0,0 +1,107 @@
+#ifndef AUTOMAT_ACTIVETILES
+#define AUTOMAT_ACTIVETILES
+
+#include <vector>
+#include <cstdint>
+
+/// @brief Rectangle of cells
+struct CellRegion {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+};
+
+/// @brief Grid split into tiles remembering which of them changed in the last evolution.
+/// A tile whose cells and neighbouring tiles did not change would evolve into its current state again,
+/// so only changed tiles and their neighbours have to be evaluated.
+class ActiveTiles {
+private:
+    /// @brief size of the grid in cells
+    size_t width = 0;
+    size_t height = 0;
+    /// @brief size of a tile in cells
+    size_t tileWidth = 1;
+    size_t tileHeight = 1;
+    /// @brief amount of tiles in a row and in a column
+    size_t tilesX = 0;
+    size_t tilesY = 0;
+    /// @brief tiles on opposite edges are neighbours
+    bool overflowEdges = true;
+    /// @brief flag of each tile, set if it changed since the last collect
+    std::vector<uint8_t> changed;
+    /// @brief tiles to be evaluated, filled by collect
+    std::vector<size_t> active;
+    /// @brief every tile has to be evaluated, set initially and after bulk changes
+    bool everything = true;
+    /// @brief flag of each tile, set if any of its cells changed since the last takeDirtyRegions
+    std::vector<uint8_t> dirty;
+    /// @brief every tile is dirty, set initially and after bulk changes
+    bool allDirty = true;
+
+public:
+    /// @brief empty tiling
+    ActiveTiles() = default;
+
+    /// @brief Tiling of a grid, every tile is considered changed
+    /// @param width width of the grid in cells
+    /// @param height height of the grid in cells
+    /// @param tileWidth width of a tile in cells
+    /// @param tileHeight height of a tile in cells
+    /// @param overflowEdges grid wraps around borders
+    ActiveTiles(const size_t width, const size_t height, const size_t tileWidth, const size_t tileHeight, const bool overflowEdges);
+
+    /// @brief consider every tile changed
+    void markAll() {
+        everything = true;
+        allDirty = true;
+    }
+
+    /// @brief consider tile containing cell changed
+    void markCell(const size_t x, const size_t y) {
+        size_t tile = (y / tileHeight) * tilesX + x / tileWidth;
+        changed[tile] = 1;
+        dirty[tile] = 1;
+    }
+
+    /// @brief Consider tiles containing a run of cells in one row changed
+    /// @param x first column of the run
+    /// @param y row of the run
+    /// @param length amount of cells, at least 1
+    void markRun(const size_t x, const size_t y, const size_t length) {
+        const size_t row = (y / tileHeight) * tilesX;
+        for (size_t tileX = x / tileWidth; tileX <= (x + length - 1) / tileWidth; tileX++) {
+            changed[row + tileX] = 1;
+            dirty[row + tileX] = 1;
+        }
+    }
+
+    /// @brief record that tile changed during evolution, safe to call for different tiles in parallel
+    void setChanged(const size_t tile) {
+        changed[tile] = 1;
+        dirty[tile] = 1;
+    }
+
+    /// @brief record that cells of tile changed without affecting which tiles get evaluated
+    void setDirty(const size_t tile) { dirty[tile] = 1; }
+
+    /// @brief Collect tiles to be evaluated and reset change flags
+    /// @param all evaluate every tile regardless of changes
+    /// @return changed tiles and their neighbours
+    const std::vector<size_t>& collect(const bool all);
+
+    /// @brief Regions covering every cell changed since the last call and reset dirty flags
+    /// @return dirty tiles, horizontally adjacent ones merged into one region
+    std::vector<CellRegion> takeDirtyRegions();
+
+    /// @brief amount of tiles
+    size_t size() const { return tilesX * tilesY; }
+
+    /// @brief first column of tile in cells
+    size_t firstColumn(const size_t tile) const { return (tile % tilesX) * tileWidth; }
+
+    /// @brief first row of tile in cells
+    size_t firstRow(const size_t tile) const { return (tile / tilesX) * tileHeight; }
+};
+
+#endif // !AUTOMAT_ACTIVETILES
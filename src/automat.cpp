@@ -8,8 +8,50 @@
 #include <algorithm>
 #include <regex>
 #include <random>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <mutex>
 
 #include "automat.hpp"
+#include "cellsampler.hpp"
+
+namespace {
+
+/// @brief most cell types whose changes are counted by comparing rows with each type instead of a histogram
+constexpr size_t COMPARED_TYPES = 8;
+
+/// @brief Add changes of the amount of each type between two generations of a row of cells
+/// @tparam Cell integer type of cells
+/// @param before cells of the earlier generation
+/// @param after cells of the later generation
+/// @param length amount of cells, at most 255
+/// @param types amount of cell types
+/// @param changes change of each type is added to it
+template<typename Cell>
+void countChanges(const Cell* before, const Cell* after, const size_t length, const size_t types, long long* changes) {
+	//branching on each changed cell would mispredict in busy regions
+	if (types > COMPARED_TYPES) {
+		for (size_t x = 0; x < length; x++) {
+			changes[before[x]]--;
+			changes[after[x]]++;
+		}
+		return;
+	}
+	//few types are counted one after another by comparisons the compiler vectorises, sums of a row fit into bytes
+	for (size_t type = 0; type < types; type++) {
+		const Cell value = static_cast<Cell>(type);
+		uint8_t entered = 0;
+		uint8_t left = 0;
+		for (size_t x = 0; x < length; x++) {
+			entered += after[x] == value;
+			left += before[x] == value;
+		}
+		changes[type] += static_cast<long long>(entered) - static_cast<long long>(left);
+	}
+}
+
+} // namespace
 
 std::vector<std::string> Automat::splitByDelim(const std::string& line, const char delim) {
 	std::vector<std::string> result;
@@ -26,15 +68,18 @@ Automat::Automat(
 	const size_t height, 
 	const std::string& cellDefinitions, 
 	const std::string& rulesDefinitions, 
-	const bool overflowEdges
+	const bool overflowEdges,
+	const Neighbourhood& neighbourhood
 )
-	: width(width),
-	height(height),
+	: rules(std::vector<Rule>()),
 	cellTypes(std::vector<CellType>()),
-	rules(std::vector<Rule>()),
-	cells(std::vector<size_t>(width*height, 0)),
+	cellDefinitions(cellDefinitions),
+	rulesDefinitions(rulesDefinitions),
+	overflowEdges(overflowEdges),
+	neighbourhood(neighbourhood),
 	name_to_index(std::unordered_map<std::string, size_t>()),
-	overflowEdges(overflowEdges)
+	width(width),
+	height(height)
 {
 	auto [success, error] = processDefinitions(cellDefinitions);
 	if (!success) {
@@ -44,6 +89,19 @@ Automat::Automat(
 	if (!success_r) {
 		throw InvalidFormatException(error_r);
 	}
+	//two state automata counting Moore neighbours are evolved bit parallel
+	auto [binary, binaryRule] = getBinaryRule();
+	useBitGrid = binary;
+	if (useBitGrid) {
+		bitGrid = BitGrid(width, height, overflowEdges, binaryRule);
+	}
+	else {
+		//grid is surrounded by halo as wide as the neighbourhood radius, extra cell type marks fixed borders
+		halo = this->neighbourhood.radius;
+		cells = CellBuffer(getStride() * (height + 2 * halo), cellTypes.size() + 1);
+		nextCells = CellBuffer(getStride() * (height + 2 * halo), cellTypes.size() + 1);
+		tiles = ActiveTiles(width, height, TILE_WIDTH, TILE_HEIGHT, overflowEdges);
+	}
 }
 
 std::pair<bool, std::string> Automat::processDefinitions(const std::string& cellDefinitions) {
@@ -84,6 +142,8 @@ std::pair<bool, std::string> Automat::processDefinitions(const std::string& cell
 				x.probability = -1;
 			}
 			cellTypes.push_back(x);
+			//colour was validated above, packed as 0xRRGGBBAA and fully opaque
+			palette.push_back((static_cast<uint32_t>(std::stoul(x.colour.substr(1), nullptr, 16)) << 8) | 0xFF);
 			auto [_, inserted] = name_to_index.insert_or_assign(x.name, counter);
 			if (!inserted) return { false, "Cell type already defined:\n" + cellLine };
 			counter++;
@@ -94,6 +154,8 @@ std::pair<bool, std::string> Automat::processDefinitions(const std::string& cell
 		}
 	}
 	if (counter <= 1) return { false, "At least two cell types must be defined!" };
+	//one cell type index is reserved for border cells
+	if (counter >= CellBuffer::MAX_STATES) return { false, "At most " + std::to_string(CellBuffer::MAX_STATES - 1) + " cell types can be defined!" };
 	return { true, "" };
 }
 
@@ -101,10 +163,23 @@ std::pair<bool, std::string> Automat::processDefinitions(const std::string& cell
 std::pair<bool, std::string> Automat::processRules(const std::string& rulesDefinitions) {
 	if (rulesDefinitions.empty()) return { false, "At least one rule must be defined!" };
 	std::istringstream rulesLines(rulesDefinitions);
+	bool neighbourhoodDefined = false;
 	for (std::string ruleLine; std::getline(rulesLines, ruleLine); )
 	{
 		//skip empty lines
 		if (ruleLine.empty()) continue;
+		//neighbourhood line replaces the neighbourhood given to the constructor
+		if (ruleLine[0] == '@') {
+			if (neighbourhoodDefined) return { false, "Neighbourhood defined twice:\n" + ruleLine };
+			auto [valid, parsed] = Neighbourhood::parse(ruleLine.substr(1));
+			if (!valid) {
+				return { false, "Invalid neighbourhood at line: (Correct example: @MOORE,2 with MOORE, VONNEUMANN or HEX and radius 1-"
+					+ std::to_string(Neighbourhood::MAX_RADIUS) + ")\n" + ruleLine };
+			}
+			neighbourhood = parsed;
+			neighbourhoodDefined = true;
+			continue;
+		}
 		try
 		{
 			//converting line into Rule structure
@@ -115,11 +190,33 @@ std::pair<bool, std::string> Automat::processRules(const std::string& rulesDefin
 			if (!exists) return { false, ("Cell type " + ruleSplit.at(0) + " doesn't exist:\n" + ruleLine) };
 			x.originalState = index;
 
-			//each character is separate digit
 			std::string neighborCount = ruleSplit.at(1);
-			for (char& c : neighborCount) {
-				if (!std::isdigit(c)) return { false, ("Non digit character '" + std::string(1, c) + "' at neighbor count:\n" + ruleLine) };
-				x.neighbors.push_back((unsigned int)c - (unsigned int)'0');
+			if (!neighborCount.empty() && neighborCount[0] == '[') {
+				//numbers and ranges separated by spaces, e.g. [3 5-12]
+				if (neighborCount.back() != ']') return { false, "Missing ']' at neighbor count:\n" + ruleLine };
+				const unsigned int maxCount = Neighbourhood{ NeighbourhoodType::moore, Neighbourhood::MAX_RADIUS }.size();
+				auto isCount = [](const std::string& text) {
+					return !text.empty() && text.size() <= 4 && std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+				};
+				std::istringstream items(neighborCount.substr(1, neighborCount.size() - 2));
+				for (std::string item; items >> item; ) {
+					const size_t dash = item.find('-');
+					const std::string first = item.substr(0, dash);
+					const std::string last = dash == std::string::npos ? first : item.substr(dash + 1);
+					if (!isCount(first) || !isCount(last)) return { false, "Invalid neighbor count '" + item + "':\n" + ruleLine };
+					const unsigned int low = static_cast<unsigned int>(std::stoul(first));
+					const unsigned int high = static_cast<unsigned int>(std::stoul(last));
+					if (low > high || high > maxCount) return { false, "Invalid neighbor count range '" + item + "':\n" + ruleLine };
+					for (unsigned int count = low; count <= high; count++) x.neighbors.push_back(count);
+				}
+				if (x.neighbors.empty()) return { false, "Empty neighbor count:\n" + ruleLine };
+			}
+			else {
+				//each character is separate digit
+				for (char& c : neighborCount) {
+					if (!std::isdigit(c)) return { false, ("Non digit character '" + std::string(1, c) + "' at neighbor count:\n" + ruleLine) };
+					x.neighbors.push_back((unsigned int)c - (unsigned int)'0');
+				}
 			}
 
 			//always convert rule
@@ -140,142 +237,944 @@ std::pair<bool, std::string> Automat::processRules(const std::string& rulesDefin
 			return { false, "Invalid rule definition at line:\n" + ruleLine };
 		}
 	}
+	//rules stored in snapshots have to reproduce the neighbourhood given to the constructor
+	if (!neighbourhoodDefined && !neighbourhood.isMoore()) {
+		this->rulesDefinitions = "@" + neighbourhood.toString() + "\n" + this->rulesDefinitions;
+	}
+	transitions.compile(rules, cellTypes.size(), neighbourhood);
 	return { true, "" };
 }
 
+void TransitionTable::compile(const std::vector<Rule>& rules, const size_t stateCount, const Neighbourhood& neighbourhood) {
+	this->neighbourhood = neighbourhood;
+	radix = static_cast<size_t>(neighbourhood.size()) + 1;
+	//edges of the spans split into straight segments, cells on a segment are summed at once
+	auto segments = [&neighbourhood](auto column) {
+		std::vector<EdgeSegment> edge;
+		const long long radius = static_cast<long long>(neighbourhood.radius);
+		long long dy = -radius;
+		while (dy <= radius) {
+			const long long slope = dy < radius ? column(dy + 1) - column(dy) : 0;
+			long long lastDy = dy;
+			while (lastDy < radius && column(lastDy + 1) - column(lastDy) == slope) lastDy++;
+			edge.push_back(EdgeSegment{ dy, lastDy, column(dy), slope });
+			dy = lastDy + 1;
+		}
+		return edge;
+	};
+	leftEdge = segments([&neighbourhood](long long dy) { return neighbourhood.left(dy) - 1; });
+	rightEdge = segments([&neighbourhood](long long dy) { return neighbourhood.right(dy); });
+	usedSlopes = { false, false, false };
+	for (const EdgeSegment& segment : leftEdge) usedSlopes[static_cast<size_t>(segment.slope + 1)] = true;
+	for (const EdgeSegment& segment : rightEdge) usedSlopes[static_cast<size_t>(segment.slope + 1)] = true;
+	entries.assign(stateCount, StateEntry());
+	table.clear();
+	countedStates.clear();
+	stateToSlot.assign(stateCount, -1);
+
+	//every state used as neighbour state gets its own slot
+	for (const Rule& rule : rules) {
+		if (rule.neighbors.empty()) continue;
+		if (stateToSlot[rule.neighborState] == -1) {
+			stateToSlot[rule.neighborState] = static_cast<long long>(countedStates.size());
+			countedStates.push_back(rule.neighborState);
+		}
+	}
+
+	for (size_t state = 0; state < stateCount; state++) {
+		StateEntry& entry = entries[state];
+		for (const Rule& rule : rules) {
+			if (rule.originalState != state) continue;
+			entry.fallback.push_back(rule);
+			//rules after always convert rule can never be applied
+			if (rule.neighbors.empty()) break;
+			size_t slot = static_cast<size_t>(stateToSlot[rule.neighborState]);
+			if (std::find(entry.slots.begin(), entry.slots.end(), slot) == entry.slots.end()) {
+				entry.slots.push_back(slot);
+			}
+		}
+
+		//block holds one result for every combination of counts of the state's slots
+		size_t blockSize = 1;
+		for (size_t i = 0; i < entry.slots.size(); i++) {
+			if (blockSize > MAX_BLOCK_SIZE / radix) {
+				entry.tabulated = false;
+				entry.strides.clear();
+				break;
+			}
+			entry.strides.push_back(blockSize);
+			blockSize *= radix;
+		}
+		if (!entry.tabulated) continue;
+
+		entry.base = table.size();
+		table.resize(table.size() + blockSize);
+		std::vector<unsigned int> counts(countedStates.size(), 0);
+		for (size_t offset = 0; offset < blockSize; offset++) {
+			for (size_t i = 0; i < entry.slots.size(); i++) {
+				counts[entry.slots[i]] = static_cast<unsigned int>((offset / entry.strides[i]) % radix);
+			}
+			table[entry.base + offset] = evaluate(state, counts.data(), 1);
+		}
+	}
+
+	//the rule shape of the presets gets a small table read by a specialised kernel
+	singleCount = countedStates.size() == 1 && stateCount <= SMALL_STATE_COUNT && neighbourhood.isMoore()
+		&& std::all_of(entries.begin(), entries.end(), [](const StateEntry& entry) { return entry.tabulated; });
+	singleCountTable.fill(0);
+	if (singleCount) {
+		for (size_t state = 0; state < stateCount; state++) {
+			for (unsigned int count = 0; count < MOORE_RADIX; count++) {
+				singleCountTable[state * MOORE_RADIX + count] = static_cast<uint8_t>(next(state, &count, 1));
+			}
+		}
+	}
+}
+
+size_t TransitionTable::evaluate(const size_t state, const unsigned int* counts, const size_t countStride) const {
+	//only one rule gets applied
+	for (const Rule& rule : entries[state].fallback) {
+		//empty size = always convert
+		if (rule.neighbors.empty()) return rule.newState;
+		unsigned int neighborsOfType = counts[stateToSlot[rule.neighborState] * countStride];
+		for (const unsigned int& amount : rule.neighbors) {
+			if (amount == neighborsOfType) return rule.newState;
+		}
+	}
+	return state;
+}
+
 std::pair<bool, size_t> Automat::cellNameToIndex(const std::string& name) const {
 	auto count = name_to_index.count(name);
 	if (count == 0) return { false, 0 };
 	else return { true, name_to_index.at(name) };
 }
 
-unsigned int Automat::getNeighborsOfType(const size_t x, const size_t y, const size_t cellType) const {
-	//Moore neighborhood
-	int vectors[][2] = { {-1,-1}, {0,-1}, {1,-1}, {1,0}, {1,1}, {0,1}, {-1,1}, {-1,0} };
-	unsigned int count = 0;
-	for (auto& vector : vectors) {
-		//conversion is safe, the number will never be large enough to overflow
-		long long new_x = static_cast<long long>(x) + vector[0];
-		long long new_y = static_cast<long long>(y) + vector[1];
-		//handle overflow
-		if (new_x < 0) {
-			if (overflowEdges) new_x = width - 1;
-			else continue;
+std::pair<bool, BinaryRule> Automat::getBinaryRule() const {
+	BinaryRule rule;
+	if (cellTypes.size() != 2 || !neighbourhood.isMoore()) return { false, rule };
+	const std::vector<size_t>& countedStates = transitions.getCountedStates();
+	for (size_t state : countedStates) {
+		//with fixed borders edge cells have less than 8 neighbours, count of state 0 can't be derived
+		if (state == 0 && !overflowEdges) return { false, rule };
+	}
+	unsigned int counts[2] = { 0, 0 };
+	for (size_t state = 0; state < 2; state++) {
+		for (unsigned int amount = 0; amount <= NEIGHBOURHOOD_SIZE; amount++) {
+			for (size_t slot = 0; slot < countedStates.size(); slot++) {
+				counts[slot] = countedStates[slot] == 1 ? amount : NEIGHBOURHOOD_SIZE - amount;
+			}
+			if (transitions.next(state, counts, 1) == 1) {
+				rule.toOne[state] |= static_cast<uint16_t>(1 << amount);
+			}
+		}
+	}
+	return { true, rule };
+}
+
+size_t Automat::getCellTypeAt(const size_t x, const size_t y) const {
+	if (useBitGrid) return bitGrid.get(x, y);
+	return cells.get(indexOf(x, y));
+}
+
+void Automat::setCellTypeAt(const size_t x, const size_t y, const size_t type) {
+	if (cycleDetection || populationCounting) {
+		const size_t previous = getCellTypeAt(x, y);
+		if (populationCounting) census.move(previous, type);
+		if (cycleDetection) {
+			const uint64_t position = static_cast<uint64_t>(y) * width + x;
+			gridHash.toggle(GridHash::key(position, previous) ^ GridHash::key(position, type));
+			gridHash.forget();
 		}
-		else if (new_x >= (signed long long)width) {
-			if (overflowEdges) new_x = 0;
-			else continue;
+	}
+	if (useBitGrid) {
+		bitGrid.set(x, y, type);
+	}
+	else {
+		cells.set(indexOf(x, y), type);
+		tiles.markCell(x, y);
+	}
+}
+
+void Automat::setCellRun(const size_t x, const size_t y, const size_t length, const size_t type) {
+	if (length == 0) return;
+	if (cycleDetection || populationCounting) {
+		uint64_t keys = 0;
+		for (size_t i = 0; i < length; i++) {
+			const size_t previous = getCellTypeAt(x + i, y);
+			if (populationCounting) census.move(previous, type);
+			if (!cycleDetection) continue;
+			const uint64_t position = static_cast<uint64_t>(y) * width + x + i;
+			keys ^= GridHash::key(position, previous) ^ GridHash::key(position, type);
 		}
-		if (new_y < 0) {
-			if (overflowEdges) new_y = height - 1;
-			else continue;
+		if (cycleDetection) {
+			gridHash.toggle(keys);
+			gridHash.forget();
 		}
-		else if (new_y >= (signed long long)height) {
-			if (overflowEdges) new_y = 0;
-			else continue;
+	}
+	if (useBitGrid) {
+		bitGrid.setRun(x, y, length, type);
+		return;
+	}
+	if (cells.getCellSize() == 1) {
+		uint8_t* first = cells.data<uint8_t>() + indexOf(x, y);
+		std::fill(first, first + length, static_cast<uint8_t>(type));
+	}
+	else {
+		uint16_t* first = cells.data<uint16_t>() + indexOf(x, y);
+		std::fill(first, first + length, static_cast<uint16_t>(type));
+	}
+	tiles.markRun(x, y, length);
+}
+
+void Automat::doOneEvolution() {
+	//grid before the first evolution since enabling detection or the last edit starts the chain of generations
+	if (cycleDetection && gridHash.empty()) gridHash.record();
+	if (useBitGrid) {
+		const FlippedCells flips = bitGrid.doOneEvolution(pool.get(), trackActiveTiles, cycleDetection, populationCounting);
+		if (cycleDetection) gridHash.toggle(flips.keys);
+		if (populationCounting) {
+			const long long changes[2] = { -flips.ones, flips.ones };
+			census.apply(changes);
 		}
-		if (getCellTypeAt(static_cast<size_t>(new_x), static_cast<size_t>(new_y)) == cellType) {
-			count++;
+	}
+	else {
+		if (cells.getCellSize() == 1) evolve<uint8_t>();
+		else evolve<uint16_t>();
+		//every cell of nextCells was written, it becomes the current generation
+		cells.swap(nextCells);
+	}
+	if (cycleDetection) gridHash.record();
+	if (populationCounting) census.record();
+}
+
+std::vector<CellRegion> Automat::takeChangedRegions() {
+	if (useBitGrid) return bitGrid.takeChangedRegions();
+	return tiles.takeDirtyRegions();
+}
+
+void Automat::doEvolutions(const unsigned long long generations) {
+	if (cycleDetection || census.getSeriesLength() > 0) {
+		//a repeating grid is back in the same state after every whole period, unless all generations go into the series
+		unsigned long long remaining = generations;
+		while (remaining > 0) {
+			doOneEvolution();
+			remaining--;
+			auto [repeats, period] = getCyclePeriod();
+			if (repeats && census.getSeriesLength() == 0) remaining %= period;
 		}
+		return;
+	}
+	if (useBitGrid) {
+		for (unsigned long long generation = 0; generation < generations; generation++) doOneEvolution();
+		return;
+	}
+	//recomputing overlapping borders of blocks only pays off when the grid does not fit in cache
+	if (2 * cells.size() * cells.getCellSize() < BLOCKING_MIN_BYTES) {
+		for (unsigned long long generation = 0; generation < generations; generation++) doOneEvolution();
+		return;
+	}
+	unsigned long long remaining = generations;
+	while (remaining > 0) {
+		//changes spread by the radius every generation
+		const size_t depth = static_cast<size_t>(std::min<unsigned long long>(remaining, std::max<size_t>(1, TEMPORAL_DEPTH / halo)));
+		if (depth == 1) doOneEvolution();
+		else if (cells.getCellSize() == 1) evolveBlocked<uint8_t>(depth);
+		else evolveBlocked<uint16_t>(depth);
+		remaining -= depth;
 	}
-	return count;
 }
 
-size_t Automat::getCellTypeAt(const size_t x, const size_t y) const {
-	size_t index = y * height + x;
-	return cells.at(index);
+template<typename Cell>
+void Automat::fillHalo() {
+	Cell* grid = cells.data<Cell>();
+	const size_t stride = getStride();
+	if (!overflowEdges) {
+		//border cells have a type no rule counts
+		const Cell border = static_cast<Cell>(cellTypes.size());
+		std::fill(grid, grid + halo * stride, border);
+		std::fill(grid + (height + halo) * stride, grid + (height + 2 * halo) * stride, border);
+		for (size_t y = halo; y < height + halo; y++) {
+			std::fill(grid + y * stride, grid + y * stride + halo, border);
+			std::fill(grid + y * stride + width + halo, grid + (y + 1) * stride, border);
+		}
+		return;
+	}
+	if (width == 0 || height == 0) return;
+	//left and right halo columns are copied from the opposite edge, the halo may be wider than the grid
+	for (size_t y = halo; y < height + halo; y++) {
+		Cell* row = grid + y * stride + halo;
+		for (size_t i = 0; i < halo; i++) {
+			*(row - 1 - i) = row[width - 1 - i % width];
+			row[width + i] = row[i % width];
+		}
+	}
+	//top and bottom halo rows including corners
+	Cell* first = grid + halo * stride;
+	for (size_t i = 0; i < halo; i++) {
+		const Cell* top = first + (height - 1 - i % height) * stride;
+		std::copy(top, top + stride, first - (i + 1) * stride);
+		const Cell* bottom = first + (i % height) * stride;
+		std::copy(bottom, bottom + stride, first + (height + i) * stride);
+	}
 }
 
-void Automat::doOneEvolution() {
-	std::vector<size_t> new_cells(cells);
-	for (size_t index = 0; index < cells.size(); index++) {
-		//convert index to coordinates
-		size_t x = index % width;
-		size_t y = index / height;
-		for (Rule& rule : rules) {
-			//only one rule gets applied
-			bool applied = false;
-			if (rule.originalState == cells.at(index)) {
-				unsigned int neighborsofType = getNeighborsOfType(x, y, rule.neighborState);
-				//empty size = always convert
-				if (rule.neighbors.size() == 0) {
-					new_cells.at(index) = rule.newState;
-					applied = true;
+template<typename Cell>
+void Automat::evolve() {
+	fillHalo<Cell>();
+	const std::vector<size_t>& activeTiles = tiles.collect(!trackActiveTiles);
+	//changes of counts are summed per range of tiles and added under the lock, sums do not depend on the order
+	std::mutex censusMutex;
+	auto evolveRange = [this, &activeTiles, &censusMutex](size_t first, size_t last) {
+		std::vector<long long> changes(populationCounting ? cellTypes.size() : 0, 0);
+		for (size_t i = first; i < last; i++) evolveTile<Cell>(activeTiles[i], populationCounting ? changes.data() : nullptr);
+		if (!populationCounting) return;
+		std::lock_guard<std::mutex> lock(censusMutex);
+		census.apply(changes.data());
+	};
+	//tiles that are not evaluated are identical in both buffers
+	if (!pool) evolveRange(0, activeTiles.size());
+	else {
+		//few chunks per thread so faster threads can take over work of slower ones
+		size_t chunk = std::max<size_t>(1, activeTiles.size() / (pool->size() * 4));
+		pool->parallelFor(0, activeTiles.size(), chunk, evolveRange);
+	}
+	//XOR does not depend on the order tiles were evolved in
+	if (cycleDetection) {
+		for (size_t tile : activeTiles) gridHash.toggle(tileKeys[tile]);
+	}
+}
+
+template<typename Cell>
+void Automat::evolveTile(const size_t tile, long long* populationChanges) {
+	//tile bounds in the haloed grid
+	const size_t firstColumn = tiles.firstColumn(tile) + halo;
+	const size_t lastColumn = std::min(firstColumn + TILE_WIDTH, width + halo);
+	const size_t firstRow = tiles.firstRow(tile) + halo;
+	const size_t lastRow = std::min(firstRow + TILE_HEIGHT, height + halo);
+	const bool changed = transitions.evolveRect<Cell>(cells.data<Cell>(), nextCells.data<Cell>(), getStride(), firstColumn, lastColumn, firstRow, lastRow);
+	if (changed) tiles.setChanged(tile);
+	if (!cycleDetection && !populationChanges) return;
+	const Cell* current = cells.data<Cell>();
+	const Cell* next = nextCells.data<Cell>();
+	const size_t stride = getStride();
+	//changed rows are counted as a whole
+	if (populationChanges && changed) {
+		for (size_t y = firstRow; y < lastRow; y++) {
+			const Cell* currentRow = current + y * stride + firstColumn;
+			const Cell* nextRow = next + y * stride + firstColumn;
+			if (std::equal(currentRow, currentRow + (lastColumn - firstColumn), nextRow)) continue;
+			countChanges(currentRow, nextRow, lastColumn - firstColumn, cellTypes.size(), populationChanges);
+		}
+	}
+	if (!cycleDetection) return;
+	//keys of changed cells, the old one leaves the hash and the new one enters it
+	uint64_t keys = 0;
+	if (changed) {
+		for (size_t y = firstRow; y < lastRow; y++) {
+			for (size_t x = firstColumn; x < lastColumn; x++) {
+				const size_t index = y * stride + x;
+				if (current[index] == next[index]) continue;
+				const uint64_t position = static_cast<uint64_t>(y - halo) * width + x - halo;
+				keys ^= GridHash::key(position, current[index]) ^ GridHash::key(position, next[index]);
+			}
+		}
+	}
+	tileKeys[tile] = keys;
+}
+
+template<typename Cell>
+bool TransitionTable::evolveRect(const Cell* current, Cell* next, const size_t stride,
+	const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const {
+	if (!neighbourhood.isMoore()) return evolveSpans<Cell>(current, next, stride, firstColumn, lastColumn, firstRow, lastRow);
+	if constexpr (std::is_same_v<Cell, uint8_t>) {
+		if (singleCount) return evolveSingleCount<SMALL_STATE_COUNT>(current, next, stride, firstColumn, lastColumn, firstRow, lastRow);
+	}
+	const size_t slotCount = countedStates.size();
+	//amount of counted cells in each column of three cells around the current row
+	unsigned int columns[STRIP_WIDTH + 2];
+	//neighbour histograms of the current row, one plane of stripWidth counts per slot
+	std::vector<unsigned int> counts(slotCount * STRIP_WIDTH, 0);
+	bool changed = false;
+
+	//wider rectangles are evolved in strips at most STRIP_WIDTH wide
+	for (size_t stripColumn = firstColumn; stripColumn < lastColumn; stripColumn += STRIP_WIDTH) {
+		const size_t stripWidth = std::min(STRIP_WIDTH, lastColumn - stripColumn);
+		for (size_t y = firstRow; y < lastRow; y++) {
+			const Cell* up = current + (y - 1) * stride + stripColumn - 1;
+			const Cell* mid = up + stride;
+			const Cell* down = mid + stride;
+			for (size_t slot = 0; slot < slotCount; slot++) {
+				const Cell type = static_cast<Cell>(countedStates[slot]);
+				for (size_t x = 0; x < stripWidth + 2; x++) {
+					columns[x] = (up[x] == type) + (mid[x] == type) + (down[x] == type);
 				}
-				for (unsigned int& amount : rule.neighbors) {
-					if (amount == neighborsofType) {
-						new_cells.at(index) = rule.newState;
-						applied = true;
-						break;
+				//neighbouring columns are shared by adjacent cells, the cell itself is not a neighbour
+				unsigned int* plane = counts.data() + slot * stripWidth;
+				for (size_t x = 0; x < stripWidth; x++) {
+					plane[x] = columns[x] + columns[x + 1] + columns[x + 2] - (mid[x + 1] == type);
+				}
+			}
+			Cell* nextRow = next + y * stride + stripColumn;
+			for (size_t x = 0; x < stripWidth; x++) {
+				nextRow[x] = static_cast<Cell>(this->next(mid[x + 1], counts.data() + x, stripWidth));
+			}
+			changed = changed || !std::equal(nextRow, nextRow + stripWidth, mid + 1);
+		}
+	}
+	return changed;
+}
+
+template<size_t STATES>
+bool TransitionTable::evolveSingleCount(const uint8_t* current, uint8_t* next, const size_t stride,
+	const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const {
+	static_assert(STATES <= SMALL_STATE_COUNT, "table holds at most SMALL_STATE_COUNT states");
+	//local copies, stores into the grid could alias members otherwise
+	std::array<uint8_t, STATES * MOORE_RADIX> lookup;
+	std::copy(singleCountTable.begin(), singleCountTable.begin() + lookup.size(), lookup.begin());
+	const uint8_t counted = static_cast<uint8_t>(countedStates[0]);
+	//amount of counted cells in each column of three cells around the current row
+	uint8_t columns[STRIP_WIDTH + 2];
+	bool changed = false;
+
+	for (size_t stripColumn = firstColumn; stripColumn < lastColumn; stripColumn += STRIP_WIDTH) {
+		const size_t stripWidth = std::min(STRIP_WIDTH, lastColumn - stripColumn);
+		for (size_t y = firstRow; y < lastRow; y++) {
+			const uint8_t* up = current + (y - 1) * stride + stripColumn - 1;
+			const uint8_t* mid = up + stride;
+			const uint8_t* down = mid + stride;
+			for (size_t x = 0; x < stripWidth + 2; x++) {
+				columns[x] = static_cast<uint8_t>((up[x] == counted) + (mid[x] == counted) + (down[x] == counted));
+			}
+			uint8_t* nextRow = next + y * stride + stripColumn;
+			for (size_t x = 0; x < stripWidth; x++) {
+				const unsigned int count = columns[x] + columns[x + 1] + columns[x + 2] - (mid[x + 1] == counted);
+				nextRow[x] = lookup[mid[x + 1] * MOORE_RADIX + count];
+			}
+			changed = changed || !std::equal(nextRow, nextRow + stripWidth, mid + 1);
+		}
+	}
+	return changed;
+}
+
+template<typename Cell>
+bool TransitionTable::evolveSpans(const Cell* current, Cell* next, const size_t stride,
+	const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const {
+	if (firstColumn >= lastColumn || firstRow >= lastRow) return false;
+	const size_t slotCount = countedStates.size();
+	const size_t radius = neighbourhood.radius;
+	const long long signedRadius = static_cast<long long>(radius);
+	//window of cells the neighbourhoods of a strip reach
+	const size_t windowHeight = lastRow - firstRow + 2 * radius;
+	const size_t maxWindowWidth = STRIP_WIDTH + 2 * radius;
+	//prefix sums of counted cells along window rows, windowWidth + 1 per row
+	std::vector<unsigned int> rowSums(slotCount * (maxWindowWidth + 1) * windowHeight);
+	//sums of counted cells along lines going down ending at each window cell, one plane per slope of the edges,
+	//padded by a row above and a column on each side holding 0 where lines start
+	const size_t linesSize = (maxWindowWidth + 2) * (windowHeight + 1);
+	std::vector<unsigned int> lineSums(slotCount * 3 * linesSize, 0);
+	//neighbour histograms of the current row, one plane of stripWidth counts per slot
+	std::vector<unsigned int> counts(slotCount * STRIP_WIDTH, 0);
+	//offsets of the last cell of each edge segment and of the cell before its first one, relative to the evolved cell
+	std::vector<long long> rightOffsets(2 * rightEdge.size());
+	std::vector<long long> leftOffsets(2 * leftEdge.size());
+	bool changed = false;
+
+	for (size_t stripColumn = firstColumn; stripColumn < lastColumn; stripColumn += STRIP_WIDTH) {
+		const size_t stripWidth = std::min(STRIP_WIDTH, lastColumn - stripColumn);
+		const size_t windowWidth = stripWidth + 2 * radius;
+		const size_t paddedWidth = windowWidth + 2;
+		const long long signedPadded = static_cast<long long>(paddedWidth);
+		const Cell* window = current + (firstRow - radius) * stride + stripColumn - radius;
+		const size_t rowSumsSize = (windowWidth + 1) * windowHeight;
+		auto segmentOffsets = [signedPadded](const std::vector<EdgeSegment>& edge, std::vector<long long>& offsets) {
+			for (size_t i = 0; i < edge.size(); i++) {
+				const EdgeSegment& segment = edge[i];
+				offsets[2 * i] = segment.lastDy * signedPadded + segment.column + segment.slope * (segment.lastDy - segment.firstDy);
+				offsets[2 * i + 1] = (segment.firstDy - 1) * signedPadded + segment.column - segment.slope;
+			}
+		};
+		segmentOffsets(rightEdge, rightOffsets);
+		segmentOffsets(leftEdge, leftOffsets);
+
+		for (size_t slot = 0; slot < slotCount; slot++) {
+			const Cell type = static_cast<Cell>(countedStates[slot]);
+			unsigned int* slotRowSums = rowSums.data() + slot * rowSumsSize;
+			unsigned int* slotLineSums = lineSums.data() + slot * 3 * linesSize;
+			//padding is cleared for every strip, the last strip may be narrower
+			for (size_t plane = 0; plane < 3; plane++) {
+				if (usedSlopes[plane]) std::fill(slotLineSums + plane * linesSize, slotLineSums + plane * linesSize + paddedWidth, 0u);
+			}
+			for (size_t y = 0; y < windowHeight; y++) {
+				const Cell* row = window + y * stride;
+				unsigned int* rowSum = slotRowSums + y * (windowWidth + 1);
+				rowSum[0] = 0;
+				for (size_t x = 0; x < windowWidth; x++) rowSum[x + 1] = rowSum[x] + (row[x] == type);
+				for (long long slope = -1; slope <= 1; slope++) {
+					if (!usedSlopes[static_cast<size_t>(slope + 1)]) continue;
+					unsigned int* sums = slotLineSums + static_cast<size_t>(slope + 1) * linesSize + (y + 1) * paddedWidth + 1;
+					const unsigned int* above = sums - signedPadded - slope;
+					sums[-1] = 0;
+					sums[windowWidth] = 0;
+					for (size_t x = 0; x < windowWidth; x++) sums[x] = above[x] + (row[x] == type);
+				}
+			}
+		}
+
+		for (size_t y = firstRow; y < lastRow; y++) {
+			const size_t windowY = y - firstRow + radius;
+			const Cell* mid = current + y * stride + stripColumn;
+			for (size_t slot = 0; slot < slotCount; slot++) {
+				const Cell type = static_cast<Cell>(countedStates[slot]);
+				const unsigned int* slotRowSums = rowSums.data() + slot * rowSumsSize;
+				const unsigned int* slotLineSums = lineSums.data() + slot * 3 * linesSize;
+				//whole neighbourhood of the first cell of the strip row, the cell itself included
+				unsigned int total = 0;
+				for (long long dy = -signedRadius; dy <= signedRadius; dy++) {
+					const unsigned int* rowSum = slotRowSums + static_cast<size_t>(static_cast<long long>(windowY) + dy) * (windowWidth + 1);
+					total += rowSum[static_cast<size_t>(signedRadius + neighbourhood.right(dy) + 1)] - rowSum[static_cast<size_t>(signedRadius + neighbourhood.left(dy))];
+				}
+				//moving right by one cell adds the right edge and removes the cells left of the spans
+				unsigned int* plane = counts.data() + slot * stripWidth;
+				const size_t rowStart = (windowY + 1) * paddedWidth + 1 + radius + 1;
+				for (size_t x = 0; x < stripWidth; x++) {
+					plane[x] = total - (mid[x] == type);
+					if (x + 1 == stripWidth) break;
+					const unsigned int* cell = slotLineSums + rowStart + x;
+					for (size_t i = 0; i < rightEdge.size(); i++) {
+						const unsigned int* sums = cell + static_cast<size_t>(rightEdge[i].slope + 1) * linesSize;
+						total += sums[rightOffsets[2 * i]] - sums[rightOffsets[2 * i + 1]];
+					}
+					for (size_t i = 0; i < leftEdge.size(); i++) {
+						const unsigned int* sums = cell + static_cast<size_t>(leftEdge[i].slope + 1) * linesSize;
+						total -= sums[leftOffsets[2 * i]] - sums[leftOffsets[2 * i + 1]];
 					}
 				}
 			}
-			if (applied) break;
+			Cell* nextRow = next + y * stride + stripColumn;
+			for (size_t x = 0; x < stripWidth; x++) {
+				nextRow[x] = static_cast<Cell>(this->next(mid[x], counts.data() + x, stripWidth));
+			}
+			changed = changed || !std::equal(nextRow, nextRow + stripWidth, mid);
 		}
 	}
-	cells = new_cells;
+	return changed;
 }
 
-std::string Automat::getColourAt(const size_t x, const size_t y) const {
-	size_t index = y * height + x;
-	size_t cellType = cells.at(index);
-	return cellTypes.at(cellType).colour;
+template bool TransitionTable::evolveRect<uint8_t>(const uint8_t* current, uint8_t* next, const size_t stride,
+	const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const;
+template bool TransitionTable::evolveRect<uint16_t>(const uint16_t* current, uint16_t* next, const size_t stride,
+	const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const;
+
+template<typename Cell>
+void Automat::evolveBlocked(const size_t generations) {
+	const std::vector<size_t>& activeTiles = tiles.collect(!trackActiveTiles);
+	const size_t tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	const size_t tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	const size_t blocksX = (tilesX + BLOCK_TILES_X - 1) / BLOCK_TILES_X;
+	const size_t blocksY = (tilesY + BLOCK_TILES_Y - 1) / BLOCK_TILES_Y;
+
+	//tiles that are not active stay unchanged for all generations of the pass, so do blocks without active tiles
+	std::vector<uint8_t> marked(blocksX * blocksY, 0);
+	for (size_t tile : activeTiles) {
+		marked[(tile / tilesX / BLOCK_TILES_Y) * blocksX + (tile % tilesX) / BLOCK_TILES_X] = 1;
+	}
+	std::vector<size_t> activeBlocks;
+	for (size_t block = 0; block < marked.size(); block++) {
+		if (marked[block]) activeBlocks.push_back(block);
+	}
+	auto forEachBlock = [this, &activeBlocks](const std::function<void(size_t)>& fn) {
+		if (!pool) {
+			for (size_t block : activeBlocks) fn(block);
+			return;
+		}
+		pool->parallelFor(0, activeBlocks.size(), 1, [&activeBlocks, &fn](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) fn(activeBlocks[i]);
+		});
+	};
+
+	//changes of counts are summed per block and added under the lock, sums do not depend on the order
+	std::mutex censusMutex;
+	forEachBlock([this, blocksX, generations, &censusMutex](size_t block) {
+		std::vector<long long> changes(populationCounting ? cellTypes.size() : 0, 0);
+		evolveBlock<Cell>((block % blocksX) * BLOCK_TILES_X, (block / blocksX) * BLOCK_TILES_Y, generations,
+			populationCounting ? changes.data() : nullptr);
+		if (!populationCounting) return;
+		std::lock_guard<std::mutex> lock(censusMutex);
+		census.apply(changes.data());
+	});
+	cells.swap(nextCells);
+
+	//evolved blocks skipped generations in nextCells, both buffers have to agree again
+	const size_t stride = getStride();
+	forEachBlock([this, blocksX, stride](size_t block) {
+		const size_t firstColumn = (block % blocksX) * BLOCK_TILES_X * TILE_WIDTH + halo;
+		const size_t lastColumn = std::min(firstColumn + BLOCK_TILES_X * TILE_WIDTH, width + halo);
+		const size_t firstRow = (block / blocksX) * BLOCK_TILES_Y * TILE_HEIGHT + halo;
+		const size_t lastRow = std::min(firstRow + BLOCK_TILES_Y * TILE_HEIGHT, height + halo);
+		const Cell* current = cells.data<Cell>();
+		Cell* next = nextCells.data<Cell>();
+		for (size_t y = firstRow; y < lastRow; y++) {
+			std::copy(current + y * stride + firstColumn, current + y * stride + lastColumn, next + y * stride + firstColumn);
+		}
+	});
 }
 
-void Automat::cellCycleType(size_t x, size_t y) {
-	size_t index = y * height + x;
-	cells.at(index)++;
-	if (cells.at(index) >= cellTypes.size()) {
-		cells.at(index) = 0;
+template<typename Cell>
+void Automat::evolveBlock(const size_t firstTileX, const size_t firstTileY, const size_t generations, long long* populationChanges) {
+	const size_t tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	const size_t tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	const size_t lastTileX = std::min(firstTileX + BLOCK_TILES_X, tilesX);
+	const size_t lastTileY = std::min(firstTileY + BLOCK_TILES_Y, tilesY);
+	//block bounds in the grid
+	const size_t blockX = firstTileX * TILE_WIDTH;
+	const size_t blockY = firstTileY * TILE_HEIGHT;
+	const size_t blockWidth = std::min(lastTileX * TILE_WIDTH, width) - blockX;
+	const size_t blockHeight = std::min(lastTileY * TILE_HEIGHT, height) - blockY;
+	//each generation needs the radius more cells around the block, scratch covers all of them
+	const size_t margin = generations * halo;
+	const size_t scratchWidth = blockWidth + 2 * margin;
+	const size_t scratchHeight = blockHeight + 2 * margin;
+	const Cell border = static_cast<Cell>(cellTypes.size());
+	const size_t stride = getStride();
+
+	//coordinate in the grid of scratch coordinate, size if it lies behind a fixed border
+	auto source = [this](const size_t block, const size_t scratch, const size_t margin, const size_t size) -> size_t {
+		long long coordinate = static_cast<long long>(block + scratch) - static_cast<long long>(margin);
+		long long length = static_cast<long long>(size);
+		if (coordinate >= 0 && coordinate < length) return static_cast<size_t>(coordinate);
+		if (!overflowEdges) return size;
+		return static_cast<size_t>(((coordinate % length) + length) % length);
+	};
+	std::vector<size_t> sourceColumns(scratchWidth);
+	for (size_t sx = 0; sx < scratchWidth; sx++) sourceColumns[sx] = source(blockX, sx, margin, width);
+
+	std::vector<Cell> scratch(scratchWidth * scratchHeight);
+	const Cell* grid = cells.data<Cell>();
+	for (size_t sy = 0; sy < scratchHeight; sy++) {
+		Cell* row = scratch.data() + sy * scratchWidth;
+		const size_t y = source(blockY, sy, margin, height);
+		if (y == height) {
+			std::fill(row, row + scratchWidth, border);
+			continue;
+		}
+		const Cell* sourceRow = grid + (y + halo) * stride + halo;
+		for (size_t sx = 0; sx < scratchWidth; sx++) {
+			row[sx] = sourceColumns[sx] == width ? border : sourceRow[sourceColumns[sx]];
+		}
+	}
+	//cells behind fixed borders are never evolved and stay in both buffers
+	std::vector<Cell> scratchNext(scratch);
+
+	//part of scratch inside the grid
+	size_t gridFirstColumn = 0, gridLastColumn = scratchWidth, gridFirstRow = 0, gridLastRow = scratchHeight;
+	if (!overflowEdges) {
+		gridFirstColumn = blockX < margin ? margin - blockX : 0;
+		gridLastColumn = std::min(scratchWidth, width - blockX + margin);
+		gridFirstRow = blockY < margin ? margin - blockY : 0;
+		gridLastRow = std::min(scratchHeight, height - blockY + margin);
+	}
+	//area with valid cells shrinks by the radius on each side every generation
+	for (size_t generation = 1; generation <= generations; generation++) {
+		const size_t shrink = generation * halo;
+		transitions.evolveRect<Cell>(scratch.data(), scratchNext.data(), scratchWidth,
+			std::max(shrink, gridFirstColumn), std::min(scratchWidth - shrink, gridLastColumn),
+			std::max(shrink, gridFirstRow), std::min(scratchHeight - shrink, gridLastRow));
+		scratch.swap(scratchNext);
+	}
+
+	//scratch holds the last generation and scratchNext the one before
+	Cell* next = nextCells.data<Cell>();
+	const Cell* start = cells.data<Cell>();
+	for (size_t ty = firstTileY; ty < lastTileY; ty++) {
+		for (size_t tx = firstTileX; tx < lastTileX; tx++) {
+			const size_t tile = ty * tilesX + tx;
+			const size_t firstColumn = tiles.firstColumn(tile);
+			const size_t tileWidth = std::min(firstColumn + TILE_WIDTH, width) - firstColumn;
+			const size_t firstRow = tiles.firstRow(tile);
+			const size_t lastRow = std::min(firstRow + TILE_HEIGHT, height);
+			bool changed = false;
+			bool differs = false;
+			for (size_t y = firstRow; y < lastRow; y++) {
+				const size_t offset = (y - blockY + margin) * scratchWidth + firstColumn - blockX + margin;
+				const Cell* evolvedRow = scratch.data() + offset;
+				const size_t index = (y + halo) * stride + firstColumn + halo;
+				changed = changed || !std::equal(evolvedRow, evolvedRow + tileWidth, scratchNext.data() + offset);
+				const bool rowDiffers = !std::equal(evolvedRow, evolvedRow + tileWidth, start + index);
+				differs = differs || rowDiffers;
+				if (populationChanges && rowDiffers) countChanges(start + index, evolvedRow, tileWidth, cellTypes.size(), populationChanges);
+				std::copy(evolvedRow, evolvedRow + tileWidth, next + index);
+			}
+			//tiles that changed only in earlier generations of the pass still have to be repainted
+			if (changed) tiles.setChanged(tile);
+			else if (differs) tiles.setDirty(tile);
+		}
 	}
 }
 
-void Automat::clearCells() {
-	std::fill(cells.begin(), cells.end(), 0);
+void Automat::setActiveTracking(const bool enabled) {
+	trackActiveTiles = enabled;
 }
 
-void Automat::randomizeCells() {
-	std::random_device rd;
-	std::mt19937 gen(rd());
+void Automat::setCycleDetection(const bool enabled, const size_t historyLength) {
+	cycleDetection = enabled;
+	gridHash = GridHash(historyLength);
+	tileKeys.clear();
+	if (!enabled) return;
+	if (!useBitGrid) tileKeys.assign(tiles.size(), 0);
+	gridHash.set(computeHash());
+}
 
-	std::uniform_int_distribution<size_t> uniform_dist(0, 100 - 1);
+void Automat::setPopulationCounting(const bool enabled, const size_t seriesLength) {
+	populationCounting = enabled;
+	census = Census();
+	if (!enabled) return;
+	census = Census(cellTypes.size(), seriesLength);
+	census.set(countCells());
+	census.record();
+}
 
-	//fill randomArray with 100 cell type (each probability times)
-	//some may have probability undefined, all those will have same probability
-	size_t randomArray [100];
-	int noProbCount = 0;
-	int totalProb = 0;
+std::vector<uint64_t> Automat::getPopulation() const {
+	return populationCounting ? census.get() : countCells();
+}
 
-	for (CellType& ctype : cellTypes) {
-		if (ctype.probability == -1) ++noProbCount;
-		else totalProb += ctype.probability;
+std::vector<std::vector<uint64_t>> Automat::getPopulationSeries() const {
+	std::vector<std::vector<uint64_t>> series;
+	for (size_t generation = 0; generation < census.getSeriesSize(); generation++) {
+		const uint64_t* counts = census.getSeries(generation);
+		series.emplace_back(counts, counts + cellTypes.size());
 	}
+	return series;
+}
+
+std::vector<uint64_t> Automat::countCells() const {
+	//rows are counted in ranges, sums of the ranges do not depend on the order
+	std::vector<uint64_t> counts(cellTypes.size(), 0);
+	std::mutex countsMutex;
+	auto countRange = [this, &counts, &countsMutex](const size_t first, const size_t last) {
+		std::vector<uint64_t> rangeCounts(cellTypes.size(), 0);
+		for (size_t y = first; y < last; y++) {
+			for (size_t x = 0; x < width; x++) rangeCounts[getCellTypeAt(x, y)]++;
+		}
+		std::lock_guard<std::mutex> lock(countsMutex);
+		for (size_t type = 0; type < counts.size(); type++) counts[type] += rangeCounts[type];
+	};
+	if (!pool) countRange(0, height);
+	else pool->parallelFor(0, height, std::max<size_t>(1, height / (pool->size() * 4)), countRange);
+	return counts;
+}
 
-	int undefProb = (100 - totalProb) / noProbCount;
+uint64_t Automat::getHash() const {
+	return cycleDetection ? gridHash.get() : computeHash();
+}
 
-	int count = 0;
-	for (size_t typeIndex = 0; typeIndex < cellTypes.size(); typeIndex++) {
-		if (cellTypes[typeIndex].probability != -1) {
-			for (int i = 0; i < cellTypes[typeIndex].probability; i++) {
-				randomArray[count + i] = typeIndex;
+std::pair<bool, unsigned long long> Automat::getCyclePeriod() const {
+	if (!cycleDetection) return { false, 0 };
+	return gridHash.getPeriod();
+}
+
+uint64_t Automat::computeHash() const {
+	//rows are hashed in parallel, XOR of the rows does not depend on the order
+	std::vector<uint64_t> rowKeys(height, 0);
+	auto hashRange = [this, &rowKeys](const size_t first, const size_t last) {
+		for (size_t y = first; y < last; y++) {
+			uint64_t keys = 0;
+			for (size_t x = 0; x < width; x++) keys ^= GridHash::key(static_cast<uint64_t>(y) * width + x, getCellTypeAt(x, y));
+			rowKeys[y] = keys;
+		}
+	};
+	if (!pool) hashRange(0, height);
+	else pool->parallelFor(0, height, std::max<size_t>(1, height / (pool->size() * 4)), hashRange);
+	uint64_t hash = 0;
+	for (uint64_t keys : rowKeys) hash ^= keys;
+	return hash;
+}
+
+void Automat::rehash() {
+	gridHash.set(computeHash());
+	gridHash.forget();
+}
+
+void Automat::setThreadCount(const size_t threads) {
+	if (threads <= 1) pool.reset();
+	else pool = std::make_shared<ThreadPool>(threads);
+}
+
+void Automat::setThreadPool(std::shared_ptr<ThreadPool> threadPool) {
+	pool = std::move(threadPool);
+}
+
+size_t Automat::getThreadCount() const {
+	return pool ? pool->size() : 1;
+}
+
+void Automat::exportPixels(uint32_t* pixels, const size_t x, const size_t y,
+	const size_t regionWidth, const size_t regionHeight, const size_t pixelStride) const {
+	for (size_t row = 0; row < regionHeight; row++) {
+		uint32_t* pixelRow = pixels + row * pixelStride;
+		if (useBitGrid) {
+			for (size_t column = 0; column < regionWidth; column++) {
+				pixelRow[column] = palette[bitGrid.get(x + column, y + row)];
 			}
-			count += cellTypes[typeIndex].probability;
+		}
+		else if (cells.getCellSize() == 1) {
+			const uint8_t* cellRow = cells.data<uint8_t>() + indexOf(x, y + row);
+			for (size_t column = 0; column < regionWidth; column++) pixelRow[column] = palette[cellRow[column]];
 		}
 		else {
-			for (int i = 0; i < undefProb; i++) {
-				randomArray[count + i] = typeIndex;
-			}
-			count += undefProb;
+			const uint16_t* cellRow = cells.data<uint16_t>() + indexOf(x, y + row);
+			for (size_t column = 0; column < regionWidth; column++) pixelRow[column] = palette[cellRow[column]];
 		}
 	}
-	//very few randomArray fields may remain empty due to rounding errors, fill them with first type
-	while (count < 100) {
-		randomArray[count] = 0;
-		count++;
+}
+
+std::string Automat::getColourAt(const size_t x, const size_t y) const {
+	size_t cellType = getCellTypeAt(x, y);
+	return cellTypes.at(cellType).colour;
+}
+
+void Automat::cellCycleType(size_t x, size_t y) {
+	size_t cellType = getCellTypeAt(x, y) + 1;
+	if (cellType >= cellTypes.size()) {
+		cellType = 0;
+	}
+	setCellTypeAt(x, y, cellType);
+}
+
+void Automat::clearCells() {
+	if (useBitGrid) {
+		bitGrid.clear();
+	}
+	else {
+		cells.fill(0);
+		tiles.markAll();
+	}
+	//all keys of the first type are zero
+	if (cycleDetection) {
+		gridHash.set(0);
+		gridHash.forget();
 	}
+	if (populationCounting) {
+		std::vector<uint64_t> counts(cellTypes.size(), 0);
+		counts[0] = static_cast<uint64_t>(width) * height;
+		census.set(counts);
+	}
+}
 
-	//populate cells randomly
-	for (size_t index = 0; index < cells.size(); index++) {
-		cells.at(index) = randomArray[uniform_dist(gen)];
+template<typename StateOf>
+void Automat::fillCells(const StateOf& stateOf) {
+	if (useBitGrid) {
+		bitGrid.fill(stateOf, pool.get());
+		return;
+	}
+	auto fillRows = [this, &stateOf](auto* data) {
+		using Cell = std::remove_pointer_t<decltype(data)>;
+		auto fillRange = [this, &stateOf, data](const size_t first, const size_t last) {
+			for (size_t y = first; y < last; y++) {
+				Cell* row = data + indexOf(0, y);
+				for (size_t x = 0; x < width; x++) row[x] = static_cast<Cell>(stateOf(x, y));
+			}
+		};
+		if (!pool) fillRange(0, height);
+		else pool->parallelFor(0, height, std::max<size_t>(1, height / (pool->size() * 4)), fillRange);
+	};
+	if (cells.getCellSize() == 1) fillRows(cells.data<uint8_t>());
+	else fillRows(cells.data<uint16_t>());
+	tiles.markAll();
+}
+
+void Automat::randomizeCells() {
+	std::random_device rd;
+	randomizeCells((static_cast<uint64_t>(rd()) << 32) | rd());
+}
+
+CellSampler Automat::getCellSampler() const {
+	//types without probability share the rest equally, weights are scaled by their amount to stay integers
+	uint64_t noProbCount = 0;
+	uint64_t totalProb = 0;
+	for (const CellType& ctype : cellTypes) {
+		if (ctype.probability == -1) ++noProbCount;
+		else totalProb += static_cast<uint64_t>(ctype.probability);
+	}
+	std::vector<uint64_t> weights;
+	for (const CellType& ctype : cellTypes) {
+		if (noProbCount == 0) weights.push_back(static_cast<uint64_t>(ctype.probability));
+		else if (ctype.probability == -1) weights.push_back(100 - totalProb);
+		else weights.push_back(static_cast<uint64_t>(ctype.probability) * noProbCount);
+	}
+	//probabilities defined for every type are used relative to their sum, all zero means uniform
+	if (noProbCount == 0 && totalProb == 0) std::fill(weights.begin(), weights.end(), 1);
+	return CellSampler(weights);
+}
+
+void Automat::randomizeCells(const uint64_t seed) {
+	const CellSampler sampler = getCellSampler();
+
+	//every cell draws from its own position in the sequence, rows can be filled in any order
+	auto stateOf = [this, &sampler, seed](const size_t x, const size_t y) {
+		return sampler.sample(CellSampler::random(seed, static_cast<uint64_t>(y) * width + x));
+	};
+	fillCells(stateOf);
+	if (cycleDetection) rehash();
+	if (populationCounting) census.set(countCells());
+}
+
+void Automat::replaceRules(const Automat& source) {
+	//cells keep their type if a type of the same name is defined, others become the first type
+	std::vector<size_t> remap(cellTypes.size(), 0);
+	bool identity = true;
+	for (size_t type = 0; type < cellTypes.size(); type++) {
+		auto [exists, index] = source.cellNameToIndex(cellTypes[type].name);
+		if (exists) remap[type] = index;
+		identity = identity && remap[type] == type;
+	}
+	const bool sameStorage = useBitGrid == source.useBitGrid && overflowEdges == source.overflowEdges && halo == source.halo
+		&& (useBitGrid || cells.getCellSize() == source.cells.getCellSize());
+	if (sameStorage && useBitGrid && identity) {
+		bitGrid.setRule(source.getBinaryRule().second);
+	}
+	else if (sameStorage && !useBitGrid) {
+		//cells are converted in place, the whole grid is evaluated in the next evolution
+		if (!identity) {
+			auto remapRows = [this, &remap](auto* data) {
+				using Cell = std::remove_pointer_t<decltype(data)>;
+				const std::vector<Cell> lookup(remap.begin(), remap.end());
+				auto remapRange = [this, &lookup, data](const size_t first, const size_t last) {
+					for (size_t y = first; y < last; y++) {
+						Cell* row = data + indexOf(0, y);
+						for (size_t x = 0; x < width; x++) row[x] = lookup[row[x]];
+					}
+				};
+				if (!pool) remapRange(0, height);
+				else pool->parallelFor(0, height, std::max<size_t>(1, height / (pool->size() * 4)), remapRange);
+			};
+			if (cells.getCellSize() == 1) remapRows(cells.data<uint8_t>());
+			else remapRows(cells.data<uint16_t>());
+		}
+		tiles.markAll();
+	}
+	else {
+		//storage changes, cells are copied into buffers laid out for the new rules
+		Automat target(width, height, source.cellDefinitions, source.rulesDefinitions, source.overflowEdges);
+		target.pool = pool;
+		target.fillCells([this, &remap](const size_t x, const size_t y) { return remap[getCellTypeAt(x, y)]; });
+		halo = target.halo;
+		useBitGrid = target.useBitGrid;
+		cells = std::move(target.cells);
+		nextCells = std::move(target.nextCells);
+		bitGrid = std::move(target.bitGrid);
+		tiles = std::move(target.tiles);
 	}
+	rules = source.rules;
+	cellTypes = source.cellTypes;
+	palette = source.palette;
+	transitions = source.transitions;
+	cellDefinitions = source.cellDefinitions;
+	rulesDefinitions = source.rulesDefinitions;
+	overflowEdges = source.overflowEdges;
+	neighbourhood = source.neighbourhood;
+	name_to_index = source.name_to_index;
+	//hashes and counts depend on type indices
+	if (cycleDetection) setCycleDetection(true, gridHash.getHistoryLength());
+	if (populationCounting) setPopulationCounting(true, census.getSeriesLength());
 }
\ No newline at end of file
@@ -6,6 +6,19 @@
 #include <list>
 #include <utility>
 #include <unordered_map>
+#include <cstdint>
+#include <array>
+
+#include <memory>
+
+#include "cellbuffer.hpp"
+#include "threadpool.hpp"
+#include "bitgrid.hpp"
+#include "activetiles.hpp"
+#include "neighbourhood.hpp"
+#include "gridhash.hpp"
+#include "census.hpp"
+#include "cellsampler.hpp"
 
 /// @brief Structure holding cell definition
 struct CellType {
@@ -22,18 +35,195 @@ struct Rule {
     size_t newState;
 };
 
+/// @brief Rules compiled into lookup tables indexed by current state and neighbour counts
+class TransitionTable {
+private:
+    /// @brief compiled transitions of a single current state
+    struct StateEntry {
+        /// @brief offset of the state's block in this->table
+        size_t base = 0;
+        /// @brief counted slots the state depends on
+        std::vector<size_t> slots{};
+        /// @brief multiplier of each slot count when indexing the block
+        std::vector<size_t> strides{};
+        /// @brief rules of this state in order, used when the block would be too large
+        std::vector<Rule> fallback{};
+        /// @brief true if the state is resolved through this->table
+        bool tabulated = true;
+    };
+
+    /// @brief maximum block size of one state before falling back to rule evaluation
+    static constexpr size_t MAX_BLOCK_SIZE = 1 << 16;
+
+    /// @brief compiled entry for every state
+    std::vector<StateEntry> entries;
+    /// @brief concatenated blocks of all tabulated states
+    std::vector<size_t> table;
+    /// @brief states referenced as neighbour state by at least one rule
+    std::vector<size_t> countedStates;
+    /// @brief maps state to its index in countedStates, -1 if not counted
+    std::vector<long long> stateToSlot;
+    /// @brief amount of possible neighbour counts (0 up to the neighbourhood size)
+    size_t radix = 0;
+    /// @brief cells counted as neighbours
+    Neighbourhood neighbourhood;
+
+    /// @brief straight part of the left or right edge of a neighbourhood, column = column + slope * (dy - firstDy)
+    struct EdgeSegment {
+        long long firstDy;
+        long long lastDy;
+        long long column;
+        long long slope;
+    };
+    /// @brief columns left of the neighbourhood spans, they leave the neighbourhood when it moves right by one cell
+    std::vector<EdgeSegment> leftEdge;
+    /// @brief last columns of the neighbourhood spans, they enter the neighbourhood when it moves right by one cell
+    std::vector<EdgeSegment> rightEdge;
+    /// @brief slopes -1, 0 and 1 occurring in the edges
+    std::array<bool, 3> usedSlopes{};
+    /// @brief width of strips evolveRect evaluates at once, neighbour counts of a strip row stay in cache
+    static constexpr size_t STRIP_WIDTH = 64;
+    /// @brief most cell types of rules evolved by evolveSingleCount, enough for all presets
+    static constexpr size_t SMALL_STATE_COUNT = 4;
+    /// @brief amount of possible counts in the Moore neighbourhood
+    static constexpr size_t MOORE_RADIX = 9;
+    /// @brief true if rules count a single state in the Moore neighbourhood and have at most SMALL_STATE_COUNT states
+    bool singleCount = false;
+    /// @brief new state indexed by state * MOORE_RADIX + count of the counted state, filled if singleCount
+    std::array<uint8_t, SMALL_STATE_COUNT * MOORE_RADIX> singleCountTable{};
+
+    /// @brief evolveRect specialised for rules counting a single state, the loops have fixed bounds the compiler can unroll
+    /// @tparam STATES upper bound of the amount of cell types, size of the lookup table
+    template<size_t STATES>
+    bool evolveSingleCount(const uint8_t* current, uint8_t* next, const size_t stride,
+        const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const;
+
+    /// @brief evolveRect for neighbourhoods other than the 8 cell Moore neighbourhood.
+    /// Counts slide along rows, cells on the edges of the neighbourhood are summed by prefix sums along lines of slope -1, 0 and 1,
+    /// so the cost per cell does not grow with the radius
+    /// @tparam Cell integer type of cells
+    template<typename Cell>
+    bool evolveSpans(const Cell* current, Cell* next, const size_t stride,
+        const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const;
+
+public:
+    /// @brief compile rules, the first matching rule of each state wins
+    /// @param rules rules in order of priority
+    /// @param stateCount amount of cell types
+    /// @param neighbourhood cells counted as neighbours
+    void compile(const std::vector<Rule>& rules, const size_t stateCount, const Neighbourhood& neighbourhood);
+
+    /// @brief cells counted as neighbours
+    const Neighbourhood& getNeighbourhood() const { return neighbourhood; }
+
+    /// @brief states whose neighbour counts the rules need, in slot order
+    const std::vector<size_t>& getCountedStates() const { return countedStates; }
+
+    /// @brief counted slots the given state depends on
+    const std::vector<size_t>& getSlotsOf(const size_t state) const { return entries[state].slots; }
+
+    /// @brief slot of counted state or -1 if the state is never counted
+    long long getSlotOf(const size_t state) const { return stateToSlot[state]; }
+
+    /// @brief resolve new state of a cell
+    /// @param state current state of the cell
+    /// @param counts neighbour counts indexed by slot, only slots of the state have to be filled
+    /// @param countStride distance between counts of consecutive slots
+    /// @return new state of the cell
+    size_t next(const size_t state, const unsigned int* counts, const size_t countStride) const {
+        const StateEntry& entry = entries[state];
+        if (!entry.tabulated) return evaluate(state, counts, countStride);
+        size_t index = entry.base;
+        for (size_t i = 0; i < entry.slots.size(); i++) {
+            index += counts[entry.slots[i] * countStride] * entry.strides[i];
+        }
+        return table[index];
+    }
+
+    /// @brief Write next generation of a rectangle of cells, cells within the neighbourhood radius around the rectangle have to be readable
+    /// @tparam Cell integer type of cells, instantiated for uint8_t and uint16_t
+    /// @param current current generation
+    /// @param next buffer the next generation is written into
+    /// @param stride distance between rows of both buffers
+    /// @param firstColumn first column of the rectangle
+    /// @param lastColumn column after the rectangle
+    /// @param firstRow first row of the rectangle
+    /// @param lastRow row after the rectangle
+    /// @return true if any cell of the rectangle changed
+    template<typename Cell>
+    bool evolveRect(const Cell* current, Cell* next, const size_t stride,
+        const size_t firstColumn, const size_t lastColumn, const size_t firstRow, const size_t lastRow) const;
+
+    /// @brief evaluate rules of the state one by one
+    /// @param state current state of the cell
+    /// @param counts neighbour counts indexed by slot
+    /// @param countStride distance between counts of consecutive slots
+    /// @return new state of the cell
+    size_t evaluate(const size_t state, const unsigned int* counts, const size_t countStride) const;
+};
+
 class Automat {
 private:
+    /// @brief amount of cells in Moore neighbourhood
+    static constexpr unsigned int NEIGHBOURHOOD_SIZE = 8;
+    /// @brief size of tiles whose changes are tracked
+    static constexpr size_t TILE_WIDTH = 64;
+    static constexpr size_t TILE_HEIGHT = 16;
+    /// @brief generations evolved per pass over a block by doEvolutions
+    static constexpr size_t TEMPORAL_DEPTH = 8;
+    /// @brief size of blocks evolved several generations at once, in tiles
+    static constexpr size_t BLOCK_TILES_X = 8;
+    static constexpr size_t BLOCK_TILES_Y = 8;
+    /// @brief size of both cell buffers from which doEvolutions evolves in blocks, smaller grids stay in cache anyway
+    static constexpr size_t BLOCKING_MIN_BYTES = size_t(64) << 20;
+    //changes spread by one cell per generation, tiles that are not active must stay unchanged during a pass
+    static_assert(TEMPORAL_DEPTH <= TILE_WIDTH && TEMPORAL_DEPTH <= TILE_HEIGHT, "pass must not reach past neighbouring tiles");
+    static_assert(Neighbourhood::MAX_RADIUS <= TILE_WIDTH && Neighbourhood::MAX_RADIUS <= TILE_HEIGHT, "neighbourhood must not reach past neighbouring tiles");
+
     /// @brief vector of automat rules
     std::vector<Rule> rules;
     /// @brief vector of cell definitions
     std::vector<CellType> cellTypes;
+    /// @brief colour of each cell type packed as 0xRRGGBBAA
+    std::vector<uint32_t> palette;
+    /// @brief rules compiled for fast lookup
+    TransitionTable transitions;
+
+    /// @brief cell definitions and rules the automat was created from, stored in snapshots
+    std::string cellDefinitions;
+    std::string rulesDefinitions;
 
     /// @brief wrap around borders
     bool overflowEdges;
+    /// @brief cells counted as neighbours
+    Neighbourhood neighbourhood;
+    /// @brief width of the halo around the grid, the radius of the neighbourhood
+    size_t halo = 1;
 
-    /// @brief test vector of automat cells
-    std::vector<size_t> cells;
+    /// @brief automat cells surrounded by a halo, one cell type index per cell
+    CellBuffer cells;
+    /// @brief buffer the next generation is written into, swapped with cells after each evolution
+    CellBuffer nextCells;
+    /// @brief bit packed cells used instead of cells and nextCells for two state automata
+    BitGrid bitGrid;
+    /// @brief true if cells are stored in bitGrid
+    bool useBitGrid = false;
+    /// @brief tiles of cells that changed in the last evolution
+    ActiveTiles tiles;
+    /// @brief evaluate only changed tiles and their neighbours
+    bool trackActiveTiles = true;
+    /// @brief workers evolving row bands in parallel, nullptr to evolve on the calling thread
+    std::shared_ptr<ThreadPool> pool;
+    /// @brief hash the grid every evolution and look for repeating generations
+    bool cycleDetection = false;
+    /// @brief hash of the grid and recent generations, maintained while cycleDetection is set
+    GridHash gridHash;
+    /// @brief XOR of GridHash keys of cells changed in each tile by the last evolution, filled while cycleDetection is set
+    std::vector<uint64_t> tileKeys;
+    /// @brief count cells of each type during evolutions and edits
+    bool populationCounting = false;
+    /// @brief amount of cells of each type and of recent generations, maintained while populationCounting is set
+    Census census;
     /// @brief map mapping cell type names to index
     std::unordered_map<std::string, size_t> name_to_index;
 
@@ -52,19 +242,73 @@ private:
     /// @return std::pair (success, error_message)
     std::pair<bool, std::string> processRules(const std::string& rulesDefinitions);
 
-    /// @brief Get amount of neighbours of specified type
-    /// @param x coordinate of cell
-    /// @param y coordinate of cell
-    /// @param cellType name of the cell type
-    /// @return amount
-    unsigned int getNeighborsOfType(const size_t x, const size_t y, const size_t type) const;
-    
-    /// @brief get type of cell at coordinates
+    /// @brief Write next generation of active tiles into nextCells, apply changed cells to hash and census
+    /// @tparam Cell integer type of cells matching cells.getCellSize()
+    template<typename Cell>
+    void evolve();
+
+    /// @brief Write next generation of a tile into nextCells and record if it changed
+    /// @tparam Cell integer type of cells matching cells.getCellSize()
+    /// @param tile index of the tile in this->tiles
+    /// @param populationChanges changes of the amount of each type are added to it, nullptr to not count them
+    template<typename Cell>
+    void evolveTile(const size_t tile, long long* populationChanges);
+
+    /// @brief Evolve blocks containing active tiles several generations at once, each in its own scratch buffer
+    /// @tparam Cell integer type of cells matching cells.getCellSize()
+    /// @param generations amount of generations, at most TEMPORAL_DEPTH
+    template<typename Cell>
+    void evolveBlocked(const size_t generations);
+
+    /// @brief Write block evolved by several generations into nextCells and record which tiles changed in the last one
+    /// @tparam Cell integer type of cells matching cells.getCellSize()
+    /// @param firstTileX column of the first tile of the block in tiles
+    /// @param firstTileY row of the first tile of the block in tiles
+    /// @param generations amount of generations, at most TEMPORAL_DEPTH
+    /// @param populationChanges changes of the amount of each type over all generations are added to it, nullptr to not count them
+    template<typename Cell>
+    void evolveBlock(const size_t firstTileX, const size_t firstTileY, const size_t generations, long long* populationChanges);
+
+    /// @brief Set every cell, rows are filled in parallel, hash and census are not updated
+    /// @tparam StateOf callable returning the type of the cell at (x, y), called from several threads at once
+    /// @param stateOf type of each cell
+    template<typename StateOf>
+    void fillCells(const StateOf& stateOf);
+
+    /// @brief Fill halo around the grid, copies of opposite edges or border cells
+    /// @tparam Cell integer type of cells matching cells.getCellSize()
+    template<typename Cell>
+    void fillHalo();
+
+    /// @brief Hash whole grid from scratch
+    /// @return XOR of GridHash keys of all cells
+    uint64_t computeHash() const;
+
+    /// @brief Recompute hash after bulk changes of cells, earlier generations are forgotten
+    void rehash();
+
+    /// @brief Count cells of each type from scratch
+    /// @return amount of cells of each type
+    std::vector<uint64_t> countCells() const;
+
+    /// @brief Fill cells from snapshot data
+    /// @param encoding how the data is stored, one of SnapshotEncoding
+    /// @param cellSize bytes per cell of raw cell data
+    /// @param data first byte of the data
+    /// @param dataSize size of the data in bytes
+    /// @return std::pair (success, error_message)
+    std::pair<bool, std::string> loadSnapshotData(const uint32_t encoding, const uint32_t cellSize,
+        const uint8_t* data, const size_t dataSize);
+
+    /// @brief index of cell at coordinates in the haloed grid
     /// @param x coordinate
     /// @param y coordinate
-    /// @return index of cell type in this->cellTypes
-    size_t getCellTypeAt(const size_t x, const size_t y) const;
-  
+    /// @return index into cells
+    size_t indexOf(const size_t x, const size_t y) const { return (y + halo) * getStride() + x + halo; }
+
+    /// @brief distance between rows of the haloed grid
+    size_t getStride() const { return width + 2 * halo; }
+
 public:
     /// @brief Automat constructor,
     /// processes cell definitions and rules
@@ -73,7 +317,9 @@ public:
     /// @param cellDefinitions string of cell definitions, separated by newline
     /// @param rulesDefinitions string of rules, separated by newline
     /// @param overflowEdges wrap around borders
-    Automat(const size_t width, const size_t height, const std::string& cellDefinitions, const std::string& rulesDefinitions, const bool overFlowEdges);
+    /// @param neighbourhood cells counted as neighbours, a neighbourhood line in the rules takes precedence
+    Automat(const size_t width, const size_t height, const std::string& cellDefinitions, const std::string& rulesDefinitions, const bool overFlowEdges,
+        const Neighbourhood& neighbourhood = Neighbourhood());
 
     /// @brief width of the automat
     size_t width;
@@ -86,12 +332,62 @@ public:
     /// @return vector of strings
     static std::vector<std::string> splitByDelim(const std::string& line, const char delim);
 
+    /// @brief cell definitions the automat was created from
+    const std::string& getCellDefinitions() const { return cellDefinitions; }
+
+    /// @brief rules the automat was created from, preceded by a neighbourhood line if the neighbourhood was given to the constructor
+    const std::string& getRulesDefinitions() const { return rulesDefinitions; }
+
+    /// @brief true if the grid wraps around borders
+    bool getOverflowEdges() const { return overflowEdges; }
+
+    /// @brief cell definitions in order of their indices
+    const std::vector<CellType>& getCellTypes() const { return cellTypes; }
+
+    /// @brief rules compiled for fast lookup
+    const TransitionTable& getTransitions() const { return transitions; }
+
+    /// @brief cells counted as neighbours
+    const Neighbourhood& getNeighbourhood() const { return neighbourhood; }
+
+    /// @brief get type of cell at coordinates
+    /// @param x coordinate
+    /// @param y coordinate
+    /// @return index of cell type in this->cellTypes
+    size_t getCellTypeAt(const size_t x, const size_t y) const;
+
+    /// @brief set type of cell at coordinates
+    /// @param x coordinate
+    /// @param y coordinate
+    /// @param type index of cell type in this->cellTypes
+    void setCellTypeAt(const size_t x, const size_t y, const size_t type);
+
+    /// @brief Set run of cells in one row to the same type
+    /// @param x first column of the run
+    /// @param y row of the run
+    /// @param length amount of cells, the run has to lie inside the row
+    /// @param type index of cell type in this->cellTypes
+    void setCellRun(const size_t x, const size_t y, const size_t length, const size_t type);
+
     /// @brief get colour of cell at coordinates
     /// @param x coordinate
     /// @param y coordinate
     /// @return string containing RGB hex string
     std::string getColourAt(const size_t x, const size_t y) const;
 
+    /// @brief colours of cell types packed as 0xRRGGBBAA, indexed like this->cellTypes
+    const std::vector<uint32_t>& getPalette() const { return palette; }
+
+    /// @brief Write colours of a region of cells into pixel buffer, one row of cells per row of pixels
+    /// @param pixels buffer of at least regionHeight rows, colours are packed as in getPalette
+    /// @param x first column of the region
+    /// @param y first row of the region
+    /// @param regionWidth width of the region, the region has to lie inside the grid
+    /// @param regionHeight height of the region
+    /// @param pixelStride distance between rows of pixels
+    void exportPixels(uint32_t* pixels, const size_t x, const size_t y,
+        const size_t regionWidth, const size_t regionHeight, const size_t pixelStride) const;
+
     /// @brief Cycle cell type at coordinates
     /// @param x coordinate
     /// @param y coordinate
@@ -103,9 +399,105 @@ public:
     /// @brief Run one evolution of cells
     void doOneEvolution();
 
-    /// @brief set all cells to random type
+    /// @brief Run several evolutions of cells, identical to calling doOneEvolution repeatedly.
+    /// Grids larger than the cache are evolved in blocks kept in cache for several generations at once.
+    /// With cycle detection every generation is evolved on its own, once the grid repeats whole periods are skipped.
+    /// With a population series every generation is evolved on its own and recorded, nothing is skipped.
+    /// @param generations amount of evolutions
+    void doEvolutions(const unsigned long long generations);
+
+    /// @brief Regions containing every cell changed by evolutions or edits since the last call.
+    /// Regions are tile sized, the whole grid is returned after bulk changes and on the first call.
+    /// @return non overlapping regions of cells
+    std::vector<CellRegion> takeChangedRegions();
+
+    /// @brief set all cells to random type, seeded from std::random_device
     void randomizeCells();
 
+    /// @brief Set all cells to random type drawn with the probabilities of the cell definitions.
+    /// Types without probability share the rest equally, if all have one they are used relative to their sum.
+    /// The result depends only on the seed and the grid size, not on the amount of threads.
+    /// @param seed seed of the random numbers
+    void randomizeCells(const uint64_t seed);
+
+    /// @brief Sampler drawing cell types with the probabilities used by randomizeCells.
+    /// Drawing the cell at (x, y) from CellSampler::random(seed, y * width + x) gives the cell randomizeCells(seed) sets.
+    CellSampler getCellSampler() const;
+
+    /// @brief Evolve using own pool of threads, results are identical to single threaded evolution
+    /// @param threads amount of threads, 1 or less evolves on the calling thread
+    void setThreadCount(const size_t threads);
+
+    /// @brief Evolve using shared pool of threads
+    /// @param threadPool pool, nullptr evolves on the calling thread
+    void setThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+    /// @brief amount of threads used for evolution
+    size_t getThreadCount() const;
+
+    /// @brief Skip parts of the grid that did not change in the last evolution, enabled by default
+    /// @param enabled false to evaluate every cell each evolution
+    void setActiveTracking(const bool enabled);
+
+    /// @brief Hash the grid incrementally every evolution and remember recent generations to detect repeating states.
+    /// Hashes are 64 bit Zobrist hashes, different grids are taken as equal only in the unlikely case of a collision.
+    /// @param enabled false to stop hashing, evolutions cost nothing extra then
+    /// @param historyLength amount of generations remembered, longest period that is detected
+    void setCycleDetection(const bool enabled, const size_t historyLength = GridHash::DEFAULT_HISTORY);
+
+    /// @brief true if the grid is hashed every evolution
+    bool getCycleDetection() const { return cycleDetection; }
+
+    /// @brief Zobrist hash of the grid, equal grids of the same size have equal hashes
+    /// @return hash maintained during evolutions with cycle detection, otherwise computed from all cells
+    uint64_t getHash() const;
+
+    /// @brief Period of the current grid, 1 for still lifes.
+    /// Generations before enabling cycle detection and before the last edit of cells are not considered.
+    /// @return std::pair (success, period), fails if the grid did not occur among the remembered generations or detection is disabled
+    std::pair<bool, unsigned long long> getCyclePeriod() const;
+
+    /// @brief Count cells of each type incrementally from the cells changed by evolutions and edits
+    /// @param enabled false to stop counting, evolutions cost nothing extra then
+    /// @param seriesLength amount of generations whose counts are remembered, 0 for none
+    void setPopulationCounting(const bool enabled, const size_t seriesLength = 0);
+
+    /// @brief true if cells are counted during evolutions
+    bool getPopulationCounting() const { return populationCounting; }
+
+    /// @brief Amount of cells of each type, indexed like this->cellTypes
+    /// @return counts maintained during evolutions with population counting, otherwise counted from all cells
+    std::vector<uint64_t> getPopulation() const;
+
+    /// @brief Amounts of cells of each type after recent generations, oldest first.
+    /// The first entry is the grid when counting was enabled until the series is full, edits show up in the following generation.
+    /// @return at most seriesLength entries, empty without population counting
+    std::vector<std::vector<uint64_t>> getPopulationSeries() const;
+
+    /// @brief Replace cell definitions, rules, neighbourhood and border mode by those of another automat, keeping the grid.
+    /// Cells keep their type if a type of the same name is defined, other cells become the first type.
+    /// Cells are converted in place unless the way they are stored changes.
+    /// Cycle detection and population counting start anew with the same settings.
+    /// @param source automat holding the new definitions and rules, its grid is ignored and may be 1x1
+    void replaceRules(const Automat& source);
+
+    /// @brief Write definitions, rules, dimensions and cells into a binary snapshot file
+    /// @param path path to the file, overwritten if it exists
+    /// @param compress store cells run length encoded instead of one after another
+    /// @throws InvalidFormatException if the file can't be written
+    void saveSnapshot(const std::string& path, const bool compress) const;
+
+    /// @brief Create automat from a binary snapshot file.
+    /// The file is memory mapped, uncompressed cells are copied row by row without parsing.
+    /// @param path path to the file
+    /// @return the automat, with active tracking enabled and evolving on the calling thread
+    /// @throws InvalidFormatException if the file can't be read or is not a valid snapshot
+    static Automat loadSnapshot(const std::string& path);
+
+    /// @brief Express rules as a two state rule counting neighbours in state 1
+    /// @return std::pair (success, rule), fails if the automat has more states or rules can't be expressed
+    std::pair<bool, BinaryRule> getBinaryRule() const;
+
     /// @brief Custom exception for inalid rules
     struct InvalidFormatException : public std::exception {
     private:
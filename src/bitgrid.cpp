@@ -0,0 +1,166 @@
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+#include "bitgrid.hpp"
+#include "gridhash.hpp"
+
+namespace {
+
+/// @brief amount of set bits in a word
+long long countOnes(uint64_t word) {
+	word = word - ((word >> 1) & 0x5555555555555555ull);
+	word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return static_cast<long long>((word * 0x0101010101010101ull) >> 56);
+}
+
+} // namespace
+
+BitGrid::BitGrid(const size_t width, const size_t height, const bool overflowEdges, const BinaryRule& rule)
+	: width(width),
+	height(height),
+	wordsPerRow((width + 63) / 64),
+	overflowEdges(overflowEdges),
+	rule(rule),
+	words(std::vector<uint64_t>(((width + 63) / 64) * height, 0)),
+	nextWords(std::vector<uint64_t>(((width + 63) / 64) * height, 0)),
+	emptyRow(std::vector<uint64_t>((width + 63) / 64, 0)),
+	tiles(ActiveTiles(width, height, TILE_WIDTH, TILE_HEIGHT, overflowEdges))
+{
+}
+
+void BitGrid::clear() {
+	std::fill(words.begin(), words.end(), 0);
+	tiles.markAll();
+}
+
+void BitGrid::setRun(const size_t x, const size_t y, const size_t length, const size_t state) {
+	if (length == 0) return;
+	uint64_t* row = words.data() + y * wordsPerRow;
+	const size_t last = x + length - 1;
+	for (size_t i = x / 64; i <= last / 64; i++) {
+		//bits of the run within word i
+		const unsigned int first = i == x / 64 ? static_cast<unsigned int>(x % 64) : 0;
+		const unsigned int end = i == last / 64 ? static_cast<unsigned int>(last % 64) : 63;
+		const uint64_t mask = (end == 63 ? ~uint64_t(0) : (uint64_t(1) << (end + 1)) - 1) & ~((uint64_t(1) << first) - 1);
+		if (state) row[i] |= mask;
+		else row[i] &= ~mask;
+	}
+	tiles.markRun(x, y, length);
+}
+
+bool BitGrid::setWords(const uint64_t* source) {
+	if (words.empty()) return true;
+	const unsigned int lastBit = static_cast<unsigned int>((width - 1) % 64);
+	const uint64_t lastMask = lastBit == 63 ? ~uint64_t(0) : (uint64_t(1) << (lastBit + 1)) - 1;
+	for (size_t y = 0; y < height; y++) {
+		if (source[y * wordsPerRow + wordsPerRow - 1] & ~lastMask) return false;
+	}
+	std::copy(source, source + words.size(), words.begin());
+	tiles.markAll();
+	return true;
+}
+
+FlippedCells BitGrid::doOneEvolution(ThreadPool* pool, const bool trackActiveTiles, const bool hashChanges, const bool countChanges) {
+	const std::vector<size_t>& activeTiles = tiles.collect(!trackActiveTiles);
+	if (hashChanges || countChanges) tileFlips.resize(tiles.size());
+	//tiles that are not evaluated are identical in both buffers
+	if (!pool) {
+		for (size_t tile : activeTiles) evolveTile(tile, hashChanges, countChanges);
+	}
+	else {
+		size_t chunk = std::max<size_t>(1, activeTiles.size() / (pool->size() * 4));
+		pool->parallelFor(0, activeTiles.size(), chunk, [this, &activeTiles, hashChanges, countChanges](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) evolveTile(activeTiles[i], hashChanges, countChanges);
+		});
+	}
+	words.swap(nextWords);
+	//XOR and sum do not depend on the order tiles were evolved in
+	FlippedCells flips;
+	if (hashChanges || countChanges) {
+		for (size_t tile : activeTiles) {
+			flips.keys ^= tileFlips[tile].keys;
+			flips.ones += tileFlips[tile].ones;
+		}
+	}
+	return flips;
+}
+
+void BitGrid::evolveTile(const size_t tile, const bool hashChanges, const bool countChanges) {
+	const size_t firstRow = tiles.firstRow(tile);
+	const size_t lastRow = std::min(firstRow + TILE_HEIGHT, height);
+	//tile is exactly one word wide
+	const size_t i = tiles.firstColumn(tile) / 64;
+	bool changed = false;
+	FlippedCells flips;
+	const size_t lastWord = wordsPerRow - 1;
+	const unsigned int lastBit = static_cast<unsigned int>((width - 1) % 64);
+	//bits after width in the last word have to stay zero
+	const uint64_t lastMask = lastBit == 63 ? ~uint64_t(0) : (uint64_t(1) << (lastBit + 1)) - 1;
+	const uint16_t anyToOne = rule.toOne[0] | rule.toOne[1];
+
+	for (size_t y = firstRow; y < lastRow; y++) {
+		const uint64_t* rows[3];
+		rows[1] = words.data() + y * wordsPerRow;
+		if (y > 0) rows[0] = rows[1] - wordsPerRow;
+		else rows[0] = overflowEdges ? words.data() + (height - 1) * wordsPerRow : emptyRow.data();
+		if (y + 1 < height) rows[2] = rows[1] + wordsPerRow;
+		else rows[2] = overflowEdges ? words.data() : emptyRow.data();
+		uint64_t* nextRow = nextWords.data() + y * wordsPerRow;
+
+		//each neighbour as a word of bits aligned with the cells of word i
+		uint64_t west[3], centre[3], east[3];
+		for (size_t r = 0; r < 3; r++) {
+			const uint64_t* row = rows[r];
+			uint64_t previous = i > 0 ? row[i - 1] : 0;
+			uint64_t following = i < lastWord ? row[i + 1] : 0;
+			centre[r] = row[i];
+			west[r] = (row[i] << 1) | (previous >> 63);
+			east[r] = (row[i] >> 1) | (following << 63);
+			if (overflowEdges && i == 0) west[r] |= (row[lastWord] >> lastBit) & 1;
+			if (overflowEdges && i == lastWord) east[r] |= (row[0] & 1) << lastBit;
+		}
+
+		//sum of the eight neighbours bit sliced into four words
+		uint64_t upSum = west[0] ^ centre[0] ^ east[0];
+		uint64_t upCarry = (west[0] & centre[0]) | (east[0] & (west[0] ^ centre[0]));
+		uint64_t downSum = west[2] ^ centre[2] ^ east[2];
+		uint64_t downCarry = (west[2] & centre[2]) | (east[2] & (west[2] ^ centre[2]));
+		uint64_t sideSum = west[1] ^ east[1];
+		uint64_t sideCarry = west[1] & east[1];
+
+		uint64_t bit0 = upSum ^ downSum ^ sideSum;
+		uint64_t onesCarry = (upSum & downSum) | (sideSum & (upSum ^ downSum));
+		uint64_t twos = upCarry ^ downCarry ^ sideCarry;
+		uint64_t twosCarry = (upCarry & downCarry) | (sideCarry & (upCarry ^ downCarry));
+		uint64_t bit1 = twos ^ onesCarry;
+		uint64_t foursCarry = twos & onesCarry;
+		uint64_t bit2 = twosCarry ^ foursCarry;
+		uint64_t bit3 = twosCarry & foursCarry;
+
+		uint64_t cell = centre[1];
+		uint64_t result = 0;
+		for (unsigned int n = 0; n <= 8; n++) {
+			const uint16_t countBit = static_cast<uint16_t>(1 << n);
+			if (!(anyToOne & countBit)) continue;
+			uint64_t match = ((n & 1) ? bit0 : ~bit0) & ((n & 2) ? bit1 : ~bit1)
+				& ((n & 4) ? bit2 : ~bit2) & ((n & 8) ? bit3 : ~bit3);
+			if (rule.toOne[1] & countBit) result |= match & cell;
+			if (rule.toOne[0] & countBit) result |= match & ~cell;
+		}
+		if (i == lastWord) result &= lastMask;
+		nextRow[i] = result;
+		changed = changed || result != centre[1];
+		const uint64_t flipped = result ^ centre[1];
+		if (!flipped) continue;
+		if (countChanges) flips.ones += countOnes(result) - countOnes(centre[1]);
+		if (!hashChanges) continue;
+		for (unsigned int bit = 0; bit < 64; bit++) {
+			if ((flipped >> bit) & 1) flips.keys ^= GridHash::key(y * width + i * 64 + bit, 1);
+		}
+	}
+	if (changed) tiles.setChanged(tile);
+	if (hashChanges || countChanges) tileFlips[tile] = flips;
+}
@@ -0,0 +1,147 @@
+#ifndef AUTOMAT_BITGRID
+#define AUTOMAT_BITGRID
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+#include "threadpool.hpp"
+#include "activetiles.hpp"
+
+/// @brief Two state rule depending only on the amount of Moore neighbours in state 1
+struct BinaryRule {
+    /// @brief for current state 0 and 1, bit n is set if the cell becomes state 1 with n neighbours in state 1
+    std::array<uint16_t, 2> toOne{};
+};
+
+/// @brief Summary of cells flipped by an evolution
+struct FlippedCells {
+    /// @brief XOR of GridHash keys of flipped cells in state 1
+    uint64_t keys = 0;
+    /// @brief cells that became state 1 minus cells that became state 0
+    long long ones = 0;
+};
+
+/// @brief Grid of two state automat packed 64 cells per word, evolved with bit parallel adders
+class BitGrid {
+private:
+    /// @brief size of tiles whose changes are tracked, one word wide
+    static constexpr size_t TILE_WIDTH = 64;
+    static constexpr size_t TILE_HEIGHT = 16;
+
+    /// @brief width of the grid
+    size_t width = 0;
+    /// @brief height of the grid
+    size_t height = 0;
+    /// @brief words per row, bits after width in the last word are always zero
+    size_t wordsPerRow = 0;
+    /// @brief wrap around borders
+    bool overflowEdges = true;
+    /// @brief rule applied to every cell
+    BinaryRule rule;
+    /// @brief current generation, rows stored one after another
+    std::vector<uint64_t> words;
+    /// @brief next generation, swapped with words after each evolution
+    std::vector<uint64_t> nextWords;
+    /// @brief row behind fixed borders, contains no cells in state 1
+    std::vector<uint64_t> emptyRow;
+    /// @brief tiles of cells that changed in the last evolution
+    ActiveTiles tiles;
+    /// @brief cells flipped in each tile by the last evolution, filled when changes are hashed or counted
+    std::vector<FlippedCells> tileFlips;
+
+    /// @brief Write next generation of a tile into nextWords and record if it changed
+    /// @param tile index of the tile in this->tiles
+    /// @param hashChanges store XOR of GridHash keys of flipped cells in tileFlips
+    /// @param countChanges store amount of flipped cells in tileFlips
+    void evolveTile(const size_t tile, const bool hashChanges, const bool countChanges);
+
+public:
+    /// @brief empty grid
+    BitGrid() = default;
+
+    /// @brief grid with all cells in state 0
+    /// @param width width of the grid
+    /// @param height height of the grid
+    /// @param overflowEdges wrap around borders
+    /// @param rule rule applied to every cell
+    BitGrid(const size_t width, const size_t height, const bool overflowEdges, const BinaryRule& rule);
+
+    /// @brief get state of cell at coordinates
+    size_t get(const size_t x, const size_t y) const {
+        return (words[y * wordsPerRow + x / 64] >> (x % 64)) & 1;
+    }
+
+    /// @brief set state of cell at coordinates
+    void set(const size_t x, const size_t y, const size_t state) {
+        uint64_t& word = words[y * wordsPerRow + x / 64];
+        uint64_t bit = uint64_t(1) << (x % 64);
+        if (state) word |= bit;
+        else word &= ~bit;
+        tiles.markCell(x, y);
+    }
+
+    /// @brief Set run of cells in one row to the same state
+    /// @param x first column of the run
+    /// @param y row of the run
+    /// @param length amount of cells, the run has to lie inside the row
+    /// @param state new state of the cells
+    void setRun(const size_t x, const size_t y, const size_t length, const size_t state);
+
+    /// @brief set all cells to state 0
+    void clear();
+
+    /// @brief Replace rule applied to every cell, the whole grid is evaluated in the next evolution
+    void setRule(const BinaryRule& newRule) {
+        rule = newRule;
+        tiles.markAll();
+    }
+
+    /// @brief Set every cell, rows are filled in parallel
+    /// @tparam StateOf callable returning the state of the cell at (x, y), called from several threads at once
+    /// @param stateOf state of each cell, 0 or 1
+    /// @param pool threads filling rows in parallel, nullptr to fill on the calling thread
+    template<typename StateOf>
+    void fill(const StateOf& stateOf, ThreadPool* pool) {
+        auto fillRange = [this, &stateOf](const size_t first, const size_t last) {
+            for (size_t y = first; y < last; y++) {
+                for (size_t i = 0; i < wordsPerRow; i++) {
+                    uint64_t word = 0;
+                    const size_t end = std::min<size_t>(64, width - i * 64);
+                    for (size_t bit = 0; bit < end; bit++) {
+                        word |= static_cast<uint64_t>(stateOf(i * 64 + bit, y) & 1) << bit;
+                    }
+                    words[y * wordsPerRow + i] = word;
+                }
+            }
+        };
+        if (!pool) fillRange(0, height);
+        else pool->parallelFor(0, height, std::max<size_t>(1, height / (pool->size() * 4)), fillRange);
+        tiles.markAll();
+    }
+
+    /// @brief words per row of packed cells, bit x % 64 of word x / 64 holds column x
+    size_t getWordsPerRow() const { return wordsPerRow; }
+
+    /// @brief packed cells, rows stored one after another
+    const std::vector<uint64_t>& getWords() const { return words; }
+
+    /// @brief Replace all cells with packed cells
+    /// @param source getWordsPerRow() * height words laid out as getWords()
+    /// @return false if a bit after width is set, the grid is left unchanged
+    bool setWords(const uint64_t* source);
+
+    /// @brief regions containing every cell changed since the last call
+    std::vector<CellRegion> takeChangedRegions() { return tiles.takeDirtyRegions(); }
+
+    /// @brief Run one evolution of cells
+    /// @param pool threads evolving tiles in parallel, nullptr to evolve on the calling thread
+    /// @param trackActiveTiles evaluate only tiles that changed in the last evolution and their neighbours
+    /// @param hashChanges compute GridHash keys of flipped cells
+    /// @param countChanges count flipped cells
+    /// @return flipped cells, members not computed are 0
+    FlippedCells doOneEvolution(ThreadPool* pool, const bool trackActiveTiles, const bool hashChanges = false, const bool countChanges = false);
+};
+
+#endif // !AUTOMAT_BITGRID
@@ -0,0 +1,78 @@
+#ifndef AUTOMAT_CELLBUFFER
+#define AUTOMAT_CELLBUFFER
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/// @brief Grid of cell type indices stored in the narrowest type able to hold all of them,
+/// 1 byte per cell up to 256 cell types, 2 bytes beyond that
+class CellBuffer {
+private:
+    /// @brief raw storage, viewed as uint8_t or uint16_t depending on cellSize
+    std::vector<uint16_t> words;
+    /// @brief amount of cells
+    size_t count = 0;
+    /// @brief bytes per cell
+    size_t cellSize = 1;
+
+public:
+    /// @brief maximum amount of cell types a buffer can hold
+    static constexpr size_t MAX_STATES = 65536;
+
+    /// @brief empty buffer
+    CellBuffer() = default;
+
+    /// @brief buffer filled with cell type 0
+    /// @param count amount of cells
+    /// @param stateCount amount of cell types the buffer has to hold
+    CellBuffer(const size_t count, const size_t stateCount)
+        : words((count * cellSizeFor(stateCount) + 1) / 2, 0),
+        count(count),
+        cellSize(cellSizeFor(stateCount)) {
+    }
+
+    /// @brief bytes per cell needed for given amount of cell types
+    static size_t cellSizeFor(const size_t stateCount) { return stateCount <= 256 ? 1 : 2; }
+
+    /// @brief amount of cells
+    size_t size() const { return count; }
+
+    /// @brief bytes per cell
+    size_t getCellSize() const { return cellSize; }
+
+    /// @brief typed pointer to the cells, Cell has to match getCellSize()
+    template<typename Cell>
+    Cell* data() { return reinterpret_cast<Cell*>(words.data()); }
+
+    /// @brief typed pointer to the cells, Cell has to match getCellSize()
+    template<typename Cell>
+    const Cell* data() const { return reinterpret_cast<const Cell*>(words.data()); }
+
+    /// @brief get cell type index at position
+    size_t get(const size_t index) const {
+        if (cellSize == 1) return data<uint8_t>()[index];
+        return words[index];
+    }
+
+    /// @brief set cell type index at position
+    void set(const size_t index, const size_t value) {
+        if (cellSize == 1) data<uint8_t>()[index] = static_cast<uint8_t>(value);
+        else words[index] = static_cast<uint16_t>(value);
+    }
+
+    /// @brief set every cell to the same cell type index
+    void fill(const size_t value) {
+        if (cellSize == 1) std::fill(data<uint8_t>(), data<uint8_t>() + count, static_cast<uint8_t>(value));
+        else std::fill(words.begin(), words.end(), static_cast<uint16_t>(value));
+    }
+
+    /// @brief exchange contents with another buffer in constant time
+    void swap(CellBuffer& other) {
+        words.swap(other.words);
+        std::swap(count, other.count);
+        std::swap(cellSize, other.cellSize);
+    }
+};
+
+#endif // !AUTOMAT_CELLBUFFER
@@ -0,0 +1,80 @@
+#ifndef AUTOMAT_CELLSAMPLER
+#define AUTOMAT_CELLSAMPLER
+
+#include <vector>
+#include <cstdint>
+
+/// @brief Draws cell types with given integer weights in constant time using Vose's alias method.
+/// Random numbers come from a counter based generator, so every cell can be drawn independently
+/// of the others and grids can be filled in parallel with the same result for the same seed.
+class CellSampler {
+private:
+    /// @brief for each column, draws below the threshold pick the column itself, others its alias
+    std::vector<uint32_t> thresholds;
+    /// @brief type picked by draws at or above the threshold of each column
+    std::vector<uint32_t> aliases;
+    /// @brief sum of all weights, draws within a column are uniform in [0, total)
+    uint64_t total = 0;
+
+public:
+    /// @brief largest sum of weights, draws are taken from 32 random bits
+    static constexpr uint64_t MAX_TOTAL = uint64_t(1) << 31;
+
+    /// @brief Build alias table in integers, the probability of each type is its weight divided by the sum of weights
+    /// up to the resolution of 32 random bits
+    /// @param weights weight of each type, their sum has to be positive and at most MAX_TOTAL
+    explicit CellSampler(const std::vector<uint64_t>& weights)
+        : thresholds(weights.size(), 0),
+        aliases(weights.size(), 0) {
+        const uint64_t count = weights.size();
+        for (uint64_t weight : weights) total += weight;
+        //weights are scaled by count so that an average column holds exactly total
+        std::vector<uint64_t> scaled(count);
+        std::vector<uint32_t> small;
+        std::vector<uint32_t> large;
+        for (uint32_t type = 0; type < count; type++) {
+            scaled[type] = weights[type] * count;
+            aliases[type] = type;
+            if (scaled[type] < total) small.push_back(type);
+            else large.push_back(type);
+        }
+        //every small column is topped up by a large one, exact in integers
+        while (!small.empty() && !large.empty()) {
+            uint32_t less = small.back();
+            small.pop_back();
+            uint32_t more = large.back();
+            thresholds[less] = static_cast<uint32_t>(scaled[less]);
+            aliases[less] = more;
+            scaled[more] -= total - scaled[less];
+            if (scaled[more] < total) {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+        //remaining columns hold exactly total
+        for (uint32_t type : large) thresholds[type] = static_cast<uint32_t>(total);
+        for (uint32_t type : small) thresholds[type] = static_cast<uint32_t>(total);
+    }
+
+    /// @brief Random number at any position of the sequence of a seed, SplitMix64 evaluated without stepping through the sequence
+    /// @param seed seed of the sequence
+    /// @param counter position in the sequence
+    static uint64_t random(const uint64_t seed, const uint64_t counter) {
+        uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// @brief Draw type
+    /// @param random uniformly distributed random number
+    /// @return index of the type
+    size_t sample(const uint64_t random) const {
+        //upper bits pick the column, lower bits decide between the column and its alias
+        const uint64_t column = ((random >> 32) * thresholds.size()) >> 32;
+        const uint64_t draw = ((random & 0xFFFFFFFFull) * total) >> 32;
+        return draw < thresholds[column] ? column : aliases[column];
+    }
+};
+
+#endif // !AUTOMAT_CELLSAMPLER
@@ -0,0 +1,74 @@
+#ifndef AUTOMAT_CENSUS
+#define AUTOMAT_CENSUS
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/// @brief Amount of cells of each type together with the amounts of recent generations.
+/// Counts are updated by the changes of each evolution and edit instead of scanning the grid.
+class Census {
+private:
+    /// @brief amount of cells of each type
+    std::vector<uint64_t> counts;
+    /// @brief ring of counts of recent generations, counts.size() values per generation
+    std::vector<uint64_t> series;
+    /// @brief amount of generations series holds
+    size_t seriesLength = 0;
+    /// @brief generation in series the next counts are written to
+    size_t newest = 0;
+    /// @brief amount of valid generations in series
+    size_t recorded = 0;
+
+public:
+    /// @brief Census of no cells
+    /// @param types amount of cell types
+    /// @param seriesLength amount of generations remembered, 0 to remember none
+    explicit Census(const size_t types = 0, const size_t seriesLength = 0)
+        : counts(types, 0),
+        series(types * seriesLength, 0),
+        seriesLength(seriesLength) {
+    }
+
+    /// @brief amount of cells of each type
+    const std::vector<uint64_t>& get() const { return counts; }
+
+    /// @brief replace counts after the grid was counted as a whole
+    void set(const std::vector<uint64_t>& values) { counts = values; }
+
+    /// @brief Apply changes of counts
+    /// @param changes change of the amount of each type, one value per type
+    void apply(const long long* changes) {
+        for (size_t type = 0; type < counts.size(); type++) counts[type] += static_cast<uint64_t>(changes[type]);
+    }
+
+    /// @brief a cell changed from one type into another
+    void move(const size_t from, const size_t to) {
+        counts[from]--;
+        counts[to]++;
+    }
+
+    /// @brief Remember current counts as the next generation, the oldest one is dropped when the series is full
+    void record() {
+        if (seriesLength == 0) return;
+        std::copy(counts.begin(), counts.end(), series.begin() + newest * counts.size());
+        newest = (newest + 1) % seriesLength;
+        recorded = std::min(recorded + 1, seriesLength);
+    }
+
+    /// @brief amount of generations the series holds at most
+    size_t getSeriesLength() const { return seriesLength; }
+
+    /// @brief amount of generations remembered, at most the series length
+    size_t getSeriesSize() const { return recorded; }
+
+    /// @brief Counts of remembered generations, oldest first
+    /// @param generation index of the generation, less than getSeriesSize()
+    /// @return counts.size() values
+    const uint64_t* getSeries(const size_t generation) const {
+        const size_t slot = (newest + seriesLength - recorded + generation) % seriesLength;
+        return series.data() + slot * counts.size();
+    }
+};
+
+#endif // !AUTOMAT_CENSUS
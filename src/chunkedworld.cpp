@@ -0,0 +1,285 @@
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+
+#include "chunkedworld.hpp"
+
+namespace {
+
+/// @brief Range of cells a chunk contributes to the halo of its neighbour in one direction
+/// @param direction position of the chunk relative to the evolved chunk, -1, 0 or 1
+/// @param halo width of the halo
+/// @param first first row or column of the chunk
+/// @param count amount of rows or columns
+/// @param target first row or column in the haloed scratch
+void haloRange(const int direction, const size_t halo, size_t& first, size_t& count, size_t& target) {
+	if (direction < 0) {
+		first = ChunkedWorld::CHUNK_SIZE - halo;
+		count = halo;
+		target = 0;
+	}
+	else if (direction > 0) {
+		first = 0;
+		count = halo;
+		target = halo + ChunkedWorld::CHUNK_SIZE;
+	}
+	else {
+		first = 0;
+		count = ChunkedWorld::CHUNK_SIZE;
+		target = halo;
+	}
+}
+
+} // namespace
+
+size_t ChunkedWorld::ChunkKeyHash::operator()(const ChunkKey& key) const {
+	uint64_t hash = static_cast<uint64_t>(key.x);
+	hash = hash * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(key.y);
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	return static_cast<size_t>(hash ^ (hash >> 31));
+}
+
+ChunkedWorld::ChunkedWorld(const Automat& automat)
+	: transitions(automat.getTransitions()),
+	stateCount(automat.getCellTypes().size()),
+	halo(automat.getNeighbourhood().radius) {
+	//empty space has to stay empty, the world is unbounded
+	std::vector<unsigned int> counts(std::max<size_t>(transitions.getCountedStates().size(), 1), 0);
+	const long long emptySlot = transitions.getSlotOf(0);
+	if (emptySlot >= 0) counts[static_cast<size_t>(emptySlot)] = automat.getNeighbourhood().size();
+	if (transitions.next(0, counts.data(), 1) != 0) {
+		throw Automat::InvalidFormatException("Unbounded grid requires cells of the first type surrounded by the first type to stay unchanged!");
+	}
+
+	//only chunks containing other cell types are stored
+	for (size_t chunkY = 0; chunkY * CHUNK_SIZE < automat.height; chunkY++) {
+		for (size_t chunkX = 0; chunkX * CHUNK_SIZE < automat.width; chunkX++) {
+			Chunk chunk = makeChunk();
+			bool occupied = false;
+			for (size_t y = 0; y < CHUNK_SIZE && chunkY * CHUNK_SIZE + y < automat.height; y++) {
+				for (size_t x = 0; x < CHUNK_SIZE && chunkX * CHUNK_SIZE + x < automat.width; x++) {
+					const size_t type = automat.getCellTypeAt(chunkX * CHUNK_SIZE + x, chunkY * CHUNK_SIZE + y);
+					if (type == 0) continue;
+					chunk.cells.set(y * CHUNK_SIZE + x, type);
+					occupied = true;
+				}
+			}
+			if (occupied) {
+				chunks.emplace(ChunkKey{ static_cast<long long>(chunkX), static_cast<long long>(chunkY) }, std::move(chunk));
+			}
+		}
+	}
+}
+
+size_t ChunkedWorld::getCellTypeAt(const long long x, const long long y) const {
+	const ChunkKey key{ chunkOf(x), chunkOf(y) };
+	auto found = chunks.find(key);
+	if (found == chunks.end()) return 0;
+	const size_t localX = static_cast<size_t>(x - key.x * static_cast<long long>(CHUNK_SIZE));
+	const size_t localY = static_cast<size_t>(y - key.y * static_cast<long long>(CHUNK_SIZE));
+	return found->second.cells.get(localY * CHUNK_SIZE + localX);
+}
+
+void ChunkedWorld::setCellTypeAt(const long long x, const long long y, const size_t type) {
+	const ChunkKey key{ chunkOf(x), chunkOf(y) };
+	auto found = chunks.find(key);
+	if (found == chunks.end()) {
+		//setting empty space to the first type changes nothing
+		if (type == 0) return;
+		found = chunks.emplace(key, makeChunk()).first;
+	}
+	const size_t localX = static_cast<size_t>(x - key.x * static_cast<long long>(CHUNK_SIZE));
+	const size_t localY = static_cast<size_t>(y - key.y * static_cast<long long>(CHUNK_SIZE));
+	found->second.cells.set(localY * CHUNK_SIZE + localX, type);
+	//chunks left empty by edits are freed by the next evolution
+	found->second.changed = true;
+}
+
+bool ChunkedWorld::touches(const Chunk& chunk, const int dx, const int dy) const {
+	size_t firstX = dx > 0 ? CHUNK_SIZE - halo : 0;
+	size_t lastX = dx < 0 ? halo : CHUNK_SIZE;
+	size_t firstY = dy > 0 ? CHUNK_SIZE - halo : 0;
+	size_t lastY = dy < 0 ? halo : CHUNK_SIZE;
+	for (size_t y = firstY; y < lastY; y++) {
+		for (size_t x = firstX; x < lastX; x++) {
+			if (chunk.cells.get(y * CHUNK_SIZE + x) != 0) return true;
+		}
+	}
+	return false;
+}
+
+template<typename Cell>
+void ChunkedWorld::evolve() {
+	//chunks whose cells changed, a chunk only changes if something in its neighbourhood did
+	std::unordered_set<ChunkKey, ChunkKeyHash> changed = freed;
+	for (const auto& [key, chunk] : chunks) {
+		if (chunk.changed) changed.insert(key);
+	}
+
+	//empty chunks are evaluated only when cells at the border of a neighbour reach them
+	auto reached = [&](const ChunkKey& key) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				auto found = chunks.find(ChunkKey{ key.x + dx, key.y + dy });
+				if (found != chunks.end() && (dx || dy) && touches(found->second, -dx, -dy)) return true;
+			}
+		}
+		return false;
+	};
+	std::unordered_set<ChunkKey, ChunkKeyHash> candidates;
+	for (const ChunkKey& key : changed) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				const ChunkKey neighbour{ key.x + dx, key.y + dy };
+				if (candidates.count(neighbour)) continue;
+				if (chunks.count(neighbour) || reached(neighbour)) candidates.insert(neighbour);
+			}
+		}
+	}
+
+	//every evaluated chunk writes into a buffer of its own, buffers are allocated only when the live set grows
+	const std::vector<ChunkKey> keys(candidates.begin(), candidates.end());
+	std::vector<CellBuffer*> targets(keys.size(), nullptr);
+	std::vector<CellBuffer> created(keys.size());
+	for (size_t i = 0; i < keys.size(); i++) {
+		auto found = chunks.find(keys[i]);
+		if (found == chunks.end()) {
+			created[i] = takeBuffer();
+			targets[i] = &created[i];
+			continue;
+		}
+		if (found->second.next.size() == 0) found->second.next = takeBuffer();
+		targets[i] = &found->second.next;
+	}
+	std::vector<char> changes(keys.size(), 0);
+	std::vector<char> empty(keys.size(), 0);
+	evaluatedChunks += keys.size();
+	const size_t haloSize = CHUNK_SIZE + 2 * halo;
+	auto evaluate = [&](size_t first, size_t last) {
+		std::vector<Cell> current(haloSize * haloSize);
+		std::vector<Cell> next(haloSize * haloSize);
+		for (size_t i = first; i < last; i++) {
+			//gather the chunk with the cells of its neighbours the neighbourhood reaches, missing neighbours are empty
+			std::fill(current.begin(), current.end(), Cell(0));
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					auto found = chunks.find(ChunkKey{ keys[i].x + dx, keys[i].y + dy });
+					if (found == chunks.end()) continue;
+					const Cell* cells = found->second.cells.template data<Cell>();
+					size_t firstX, countX, targetX, firstY, countY, targetY;
+					haloRange(dx, halo, firstX, countX, targetX);
+					haloRange(dy, halo, firstY, countY, targetY);
+					for (size_t y = 0; y < countY; y++) {
+						std::copy(cells + (firstY + y) * CHUNK_SIZE + firstX, cells + (firstY + y) * CHUNK_SIZE + firstX + countX,
+							current.data() + (targetY + y) * haloSize + targetX);
+					}
+				}
+			}
+			changes[i] = transitions.evolveRect<Cell>(current.data(), next.data(), haloSize, halo, halo + CHUNK_SIZE, halo, halo + CHUNK_SIZE);
+			Cell* cells = targets[i]->template data<Cell>();
+			bool occupied = false;
+			for (size_t y = 0; y < CHUNK_SIZE; y++) {
+				const Cell* row = next.data() + (y + halo) * haloSize + halo;
+				std::copy(row, row + CHUNK_SIZE, cells + y * CHUNK_SIZE);
+				occupied = occupied || std::any_of(row, row + CHUNK_SIZE, [](Cell cell) { return cell != 0; });
+			}
+			empty[i] = !occupied;
+		}
+	};
+	if (pool) pool->parallelFor(0, keys.size(), 1, evaluate);
+	else evaluate(0, keys.size());
+
+	//results are applied after all chunks are evaluated, they read neighbours of the current generation
+	freed.clear();
+	for (auto& [key, chunk] : chunks) chunk.changed = false;
+	for (size_t i = 0; i < keys.size(); i++) {
+		auto found = chunks.find(keys[i]);
+		if (found == chunks.end()) {
+			if (empty[i]) spare.push_back(std::move(created[i]));
+			else chunks.emplace(keys[i], Chunk{ std::move(created[i]), CellBuffer(), changes[i] != 0 });
+			continue;
+		}
+		if (empty[i]) {
+			spare.push_back(std::move(found->second.cells));
+			spare.push_back(std::move(found->second.next));
+			chunks.erase(found);
+			freed.insert(keys[i]);
+			continue;
+		}
+		found->second.cells.swap(found->second.next);
+		found->second.changed = changes[i] != 0;
+	}
+}
+
+CellBuffer ChunkedWorld::takeBuffer() {
+	if (spare.empty()) return CellBuffer(CHUNK_SIZE * CHUNK_SIZE, stateCount);
+	CellBuffer buffer = std::move(spare.back());
+	spare.pop_back();
+	return buffer;
+}
+
+void ChunkedWorld::doOneEvolution() {
+	if (CellBuffer::cellSizeFor(stateCount) == 1) evolve<uint8_t>();
+	else evolve<uint16_t>();
+	generation++;
+}
+
+void ChunkedWorld::doEvolutions(const unsigned long long generations) {
+	for (unsigned long long i = 0; i < generations; i++) doOneEvolution();
+}
+
+std::pair<bool, WorldRegion> ChunkedWorld::getBounds() const {
+	bool found = false;
+	long long minX = 0, minY = 0, maxX = 0, maxY = 0;
+	for (const auto& [key, chunk] : chunks) {
+		for (size_t y = 0; y < CHUNK_SIZE; y++) {
+			for (size_t x = 0; x < CHUNK_SIZE; x++) {
+				if (chunk.cells.get(y * CHUNK_SIZE + x) == 0) continue;
+				const long long worldX = key.x * static_cast<long long>(CHUNK_SIZE) + static_cast<long long>(x);
+				const long long worldY = key.y * static_cast<long long>(CHUNK_SIZE) + static_cast<long long>(y);
+				if (!found) {
+					minX = maxX = worldX;
+					minY = maxY = worldY;
+					found = true;
+				}
+				minX = std::min(minX, worldX);
+				maxX = std::max(maxX, worldX);
+				minY = std::min(minY, worldY);
+				maxY = std::max(maxY, worldY);
+			}
+		}
+	}
+	if (!found) return { false, WorldRegion{} };
+	return { true, WorldRegion{ minX, minY, static_cast<size_t>(maxX - minX + 1), static_cast<size_t>(maxY - minY + 1) } };
+}
+
+void ChunkedWorld::writeTo(Automat& automat, const long long x, const long long y) const {
+	for (size_t row = 0; row < automat.height; row++) {
+		const long long worldY = y + static_cast<long long>(row);
+		size_t column = 0;
+		while (column < automat.width) {
+			//copy the part of the row lying in one chunk
+			const long long worldX = x + static_cast<long long>(column);
+			const ChunkKey key{ chunkOf(worldX), chunkOf(worldY) };
+			const size_t localX = static_cast<size_t>(worldX - key.x * static_cast<long long>(CHUNK_SIZE));
+			const size_t localY = static_cast<size_t>(worldY - key.y * static_cast<long long>(CHUNK_SIZE));
+			const size_t length = std::min(CHUNK_SIZE - localX, automat.width - column);
+			auto found = chunks.find(key);
+			if (found == chunks.end()) automat.setCellRun(column, row, length, 0);
+			else {
+				for (size_t i = 0; i < length; i++) {
+					automat.setCellTypeAt(column + i, row, found->second.cells.get(localY * CHUNK_SIZE + localX + i));
+				}
+			}
+			column += length;
+		}
+	}
+}
+
+void ChunkedWorld::setThreadCount(const size_t threads) {
+	if (threads <= 1) pool.reset();
+	else pool = std::make_shared<ThreadPool>(threads);
+}
@@ -0,0 +1,147 @@
+#ifndef AUTOMAT_CHUNKEDWORLD
+#define AUTOMAT_CHUNKEDWORLD
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <cstdint>
+
+#include "automat.hpp"
+#include "cellbuffer.hpp"
+#include "threadpool.hpp"
+
+/// @brief Rectangle of an unbounded world, coordinates may be negative
+struct WorldRegion {
+    long long x = 0;
+    long long y = 0;
+    size_t width = 0;
+    size_t height = 0;
+};
+
+/// @brief Unbounded grid stored as square chunks in a hash map keyed by chunk coordinates.
+/// Cells outside of stored chunks are of the first cell type. Chunks are allocated when activity reaches them
+/// and freed when all their cells return to the first cell type, so memory and evolution time
+/// depend on the live region rather than on a fixed rectangle.
+class ChunkedWorld {
+public:
+    /// @brief width and height of a chunk in cells
+    static constexpr size_t CHUNK_SIZE = 64;
+    //neighbourhoods must not reach past neighbouring chunks
+    static_assert(Neighbourhood::MAX_RADIUS <= CHUNK_SIZE, "halo must come from neighbouring chunks only");
+
+private:
+    /// @brief coordinates of a chunk, world coordinates divided by CHUNK_SIZE rounding down
+    struct ChunkKey {
+        long long x;
+        long long y;
+        bool operator==(const ChunkKey& other) const { return x == other.x && y == other.y; }
+    };
+
+    /// @brief hash of chunk coordinates
+    struct ChunkKeyHash {
+        size_t operator()(const ChunkKey& key) const;
+    };
+
+    /// @brief stored part of the world
+    struct Chunk {
+        /// @brief cells one row after another, at least one is not of the first cell type after each evolution
+        CellBuffer cells;
+        /// @brief buffer the next generation is written into, swapped with cells, empty until the chunk is first evaluated
+        CellBuffer next;
+        /// @brief some cell changed in the last evolution or by an edit
+        bool changed = true;
+    };
+
+    /// @brief rules compiled for fast lookup, copied from the automat
+    TransitionTable transitions;
+    /// @brief amount of cell types
+    size_t stateCount = 0;
+    /// @brief cells of neighbouring chunks gathered around a chunk, the radius of the neighbourhood
+    size_t halo = 1;
+    /// @brief stored chunks
+    std::unordered_map<ChunkKey, Chunk, ChunkKeyHash> chunks;
+    /// @brief buffers of freed chunks and of evaluated chunks that stayed empty, reused before allocating new ones
+    std::vector<CellBuffer> spare;
+    /// @brief chunks freed in the last evolution, their cells changed as well
+    std::unordered_set<ChunkKey, ChunkKeyHash> freed;
+    /// @brief workers evolving chunks in parallel, nullptr to evolve on the calling thread
+    std::shared_ptr<ThreadPool> pool;
+    /// @brief amount of evolutions since construction
+    uint64_t generation = 0;
+    /// @brief chunks evaluated by all evolutions since construction
+    uint64_t evaluatedChunks = 0;
+
+    /// @brief chunk coordinate of a world coordinate
+    static long long chunkOf(const long long coordinate) {
+        const long long size = static_cast<long long>(CHUNK_SIZE);
+        return coordinate >= 0 ? coordinate / size : -((-coordinate + size - 1) / size);
+    }
+
+    /// @brief empty chunk able to hold all cell types
+    Chunk makeChunk() const { return Chunk{ CellBuffer(CHUNK_SIZE * CHUNK_SIZE, stateCount), CellBuffer(), true }; }
+
+    /// @brief chunk sized buffer of unspecified cells, a spare one if there is any
+    CellBuffer takeBuffer();
+
+    /// @brief Check if cells of a chunk within the halo of a neighbouring chunk are not all of the first type
+    /// @param chunk the chunk
+    /// @param dx direction of the neighbour, -1, 0 or 1
+    /// @param dy direction of the neighbour, -1, 0 or 1
+    bool touches(const Chunk& chunk, const int dx, const int dy) const;
+
+    /// @brief Evolve every chunk whose neighbourhood changed in the last evolution
+    /// @tparam Cell integer type of cells matching CellBuffer::cellSizeFor(stateCount)
+    template<typename Cell>
+    void evolve();
+
+public:
+    /// @brief Copy rules and cells of an automat, grid coordinates become world coordinates
+    /// @param automat the automat
+    /// @throws Automat::InvalidFormatException if cells of the first type surrounded only by the first type change,
+    /// the whole unbounded world would change then
+    explicit ChunkedWorld(const Automat& automat);
+
+    /// @brief get type of cell at world coordinates
+    size_t getCellTypeAt(const long long x, const long long y) const;
+
+    /// @brief set type of cell at world coordinates, allocates its chunk if needed
+    void setCellTypeAt(const long long x, const long long y, const size_t type);
+
+    /// @brief Run one evolution of cells
+    void doOneEvolution();
+
+    /// @brief Run several evolutions of cells
+    /// @param generations amount of evolutions
+    void doEvolutions(const unsigned long long generations);
+
+    /// @brief amount of evolutions since construction
+    uint64_t getGeneration() const { return generation; }
+
+    /// @brief chunks evaluated by all evolutions since construction, unchanged chunks are skipped
+    uint64_t getEvaluatedChunks() const { return evaluatedChunks; }
+
+    /// @brief amount of stored chunks
+    size_t getChunkCount() const { return chunks.size(); }
+
+    /// @brief Smallest rectangle containing every cell not of the first type
+    /// @return std::pair (success, region), fails if all cells are of the first type
+    std::pair<bool, WorldRegion> getBounds() const;
+
+    /// @brief Copy region of the world into the whole grid of an automat
+    /// @param automat automat with the same cell types, its grid size is the size of the region
+    /// @param x world coordinate of the grid's first column
+    /// @param y world coordinate of the grid's first row
+    void writeTo(Automat& automat, const long long x, const long long y) const;
+
+    /// @brief Evolve chunks using own pool of threads, results are identical to single threaded evolution
+    /// @param threads amount of threads, 1 or less evolves on the calling thread
+    void setThreadCount(const size_t threads);
+
+    /// @brief Evolve chunks using shared pool of threads
+    /// @param threadPool pool, nullptr evolves on the calling thread
+    void setThreadPool(std::shared_ptr<ThreadPool> threadPool) { pool = std::move(threadPool); }
+};
+
+#endif // !AUTOMAT_CHUNKEDWORLD
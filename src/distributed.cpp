@@ -0,0 +1,344 @@
+#include <vector>
+#include <array>
+#include <string>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "distributed.hpp"
+
+namespace {
+
+/// @brief offsets of the neighbouring regions, opposite directions are neighbours in this order
+constexpr std::array<int, DistributedGrid::DIRECTIONS> DX = { 0, 0, -1, 1, -1, 1, 1, -1 };
+constexpr std::array<int, DistributedGrid::DIRECTIONS> DY = { -1, 1, 0, 0, -1, 1, -1, 1 };
+
+/// @brief direction pointing the other way
+size_t opposite(const size_t direction) {
+	return direction ^ 1;
+}
+
+/// @brief Range of rows or columns along one axis of the haloed region
+/// @param direction offset of the neighbour along the axis, -1, 0 or 1
+/// @param halo width of the halo
+/// @param size owned rows or columns
+/// @param inside owned cells next to the neighbour instead of halo cells coming from it
+/// @param first first row or column
+/// @param count amount of rows or columns
+void span(const int direction, const size_t halo, const size_t size, const bool inside, size_t& first, size_t& count) {
+	if (direction == 0) {
+		first = halo;
+		count = size;
+		return;
+	}
+	count = halo;
+	if (direction < 0) first = inside ? halo : 0;
+	else first = inside ? size : halo + size;
+}
+
+} // namespace
+
+DistributedGrid::DistributedGrid(const Automat& automat, const size_t gridWidth, const size_t gridHeight, HaloTransport& transport)
+	: transitions(automat.getTransitions()),
+	sampler(automat.getCellSampler()),
+	stateCount(automat.getCellTypes().size()),
+	halo(automat.getNeighbourhood().radius),
+	overflowEdges(automat.getOverflowEdges()),
+	width(gridWidth),
+	height(gridHeight),
+	transport(transport) {
+	auto [valid, layout] = chooseLayout(width, height, halo, transport.getSize());
+	if (!valid) {
+		throw Automat::InvalidFormatException("Grid is too small to be split among " + std::to_string(transport.getSize()) + " processes!");
+	}
+	columns = layout.first;
+	rows = layout.second;
+
+	const size_t rank = transport.getRank();
+	region = regionOf(rank);
+	const long long column = static_cast<long long>(rank % columns);
+	const long long row = static_cast<long long>(rank / columns);
+	for (size_t direction = 0; direction < DIRECTIONS; direction++) {
+		long long x = column + DX[direction];
+		long long y = row + DY[direction];
+		const long long regionColumns = static_cast<long long>(columns);
+		const long long regionRows = static_cast<long long>(rows);
+		if (overflowEdges) {
+			x = (x + regionColumns) % regionColumns;
+			y = (y + regionRows) % regionRows;
+		}
+		const bool inside = x >= 0 && x < regionColumns && y >= 0 && y < regionRows;
+		neighbours[direction] = inside ? y * regionColumns + x : -1;
+	}
+
+	//halo beyond fixed borders keeps the border type no rule counts, evolutions never write it
+	cells = CellBuffer(getStride() * (region.height + 2 * halo), stateCount + 1);
+	cells.fill(stateCount);
+	for (size_t y = 0; y < region.height; y++) setCellRun(region.x, region.y + y, region.width, 0);
+	nextCells = cells;
+
+	bool remote = false;
+	for (long long peer : neighbours) remote = remote || (peer >= 0 && static_cast<size_t>(peer) != rank);
+	if (remote) sender = std::thread(&DistributedGrid::send, this);
+}
+
+DistributedGrid::~DistributedGrid() {
+	if (!sender.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(senderMutex);
+		stopping = true;
+	}
+	sendStarted.notify_one();
+	sender.join();
+}
+
+void DistributedGrid::send() {
+	const size_t rank = transport.getRank();
+	std::unique_lock<std::mutex> lock(senderMutex);
+	while (true) {
+		sendStarted.wait(lock, [this] { return sending || stopping; });
+		if (stopping) return;
+		lock.unlock();
+		//messages to each peer are sent in direction order
+		std::exception_ptr error;
+		try {
+			for (size_t direction = 0; direction < DIRECTIONS; direction++) {
+				const long long peer = neighbours[direction];
+				if (peer < 0 || static_cast<size_t>(peer) == rank) continue;
+				transport.send(static_cast<size_t>(peer), outgoing[direction].data(), outgoing[direction].size());
+			}
+		}
+		catch (...) {
+			error = std::current_exception();
+			//receives waiting for this or another process fail instead of blocking forever
+			transport.shutdown();
+		}
+		lock.lock();
+		sendError = error;
+		sending = false;
+		sendFinished.notify_one();
+	}
+}
+
+std::pair<bool, std::pair<size_t, size_t>> DistributedGrid::chooseLayout(const size_t gridWidth, const size_t gridHeight,
+	const size_t radius, const size_t processes) {
+	bool found = false;
+	size_t shortest = 0;
+	std::pair<size_t, size_t> layout{ 1, 1 };
+	for (size_t columns = 1; columns <= processes; columns++) {
+		if (processes % columns != 0) continue;
+		const size_t rows = processes / columns;
+		//halos must come from direct neighbours only
+		if (gridWidth / columns < radius || gridHeight / rows < radius) continue;
+		const size_t cut = columns * gridHeight + rows * gridWidth;
+		if (found && cut >= shortest) continue;
+		found = true;
+		shortest = cut;
+		layout = { columns, rows };
+	}
+	return { found, layout };
+}
+
+CellRegion DistributedGrid::regionOf(const size_t rank) const {
+	const size_t column = rank % columns;
+	const size_t row = rank / columns;
+	const size_t x = column * width / columns;
+	const size_t y = row * height / rows;
+	return { x, y, (column + 1) * width / columns - x, (row + 1) * height / rows - y };
+}
+
+CellRegion DistributedGrid::edgeOf(const size_t direction) const {
+	CellRegion rect{};
+	span(DX[direction], halo, region.width, true, rect.x, rect.width);
+	span(DY[direction], halo, region.height, true, rect.y, rect.height);
+	return rect;
+}
+
+CellRegion DistributedGrid::haloOf(const size_t direction) const {
+	CellRegion rect{};
+	span(DX[direction], halo, region.width, false, rect.x, rect.width);
+	span(DY[direction], halo, region.height, false, rect.y, rect.height);
+	return rect;
+}
+
+void DistributedGrid::pack(const CellRegion& rect, std::vector<uint8_t>& buffer) const {
+	const size_t cellSize = cells.getCellSize();
+	const size_t rowSize = rect.width * cellSize;
+	buffer.resize(rect.height * rowSize);
+	const uint8_t* grid = cells.data<uint8_t>();
+	for (size_t y = 0; y < rect.height; y++) {
+		std::memcpy(buffer.data() + y * rowSize, grid + ((rect.y + y) * getStride() + rect.x) * cellSize, rowSize);
+	}
+}
+
+void DistributedGrid::unpack(const CellRegion& rect, const std::vector<uint8_t>& buffer) {
+	const size_t cellSize = cells.getCellSize();
+	const size_t rowSize = rect.width * cellSize;
+	uint8_t* grid = cells.data<uint8_t>();
+	for (size_t y = 0; y < rect.height; y++) {
+		std::memcpy(grid + ((rect.y + y) * getStride() + rect.x) * cellSize, buffer.data() + y * rowSize, rowSize);
+	}
+}
+
+size_t DistributedGrid::getCellTypeAt(const size_t x, const size_t y) const {
+	return cells.get((y - region.y + halo) * getStride() + x - region.x + halo);
+}
+
+void DistributedGrid::setCellTypeAt(const size_t x, const size_t y, const size_t type) {
+	cells.set((y - region.y + halo) * getStride() + x - region.x + halo, type);
+}
+
+void DistributedGrid::setCellRun(const size_t x, const size_t y, const size_t length, const size_t type) {
+	if (y < region.y || y >= region.y + region.height) return;
+	const size_t first = std::max(x, region.x);
+	const size_t last = std::min(x + length, region.x + region.width);
+	for (size_t column = first; column < last; column++) setCellTypeAt(column, y, type);
+}
+
+void DistributedGrid::randomizeCells(const uint64_t seed) {
+	//every cell draws from its position in the whole grid
+	for (size_t y = region.y; y < region.y + region.height; y++) {
+		for (size_t x = region.x; x < region.x + region.width; x++) {
+			setCellTypeAt(x, y, sampler.sample(CellSampler::random(seed, static_cast<uint64_t>(y) * width + x)));
+		}
+	}
+}
+
+template<typename Cell>
+void DistributedGrid::evolve() {
+	const size_t rank = transport.getRank();
+	//edges are packed before evolving, a wrapped region being its own neighbour fills its halo directly
+	bool remote = false;
+	for (size_t direction = 0; direction < DIRECTIONS; direction++) {
+		if (neighbours[direction] < 0) continue;
+		pack(edgeOf(direction), outgoing[direction]);
+		if (static_cast<size_t>(neighbours[direction]) == rank) unpack(haloOf(opposite(direction)), outgoing[direction]);
+		else remote = true;
+	}
+
+	//edges travel while the inner cells are evolved
+	if (remote) {
+		{
+			std::lock_guard<std::mutex> lock(senderMutex);
+			sending = true;
+		}
+		sendStarted.notify_one();
+	}
+
+	const Cell* current = cells.data<Cell>();
+	Cell* next = nextCells.data<Cell>();
+	const size_t stride = getStride();
+	auto evolveRect = [this, current, next, stride](size_t firstColumn, size_t lastColumn, size_t firstRow, size_t lastRow) {
+		if (firstColumn < lastColumn && firstRow < lastRow) {
+			transitions.evolveRect<Cell>(current, next, stride, firstColumn, lastColumn, firstRow, lastRow);
+		}
+	};
+	//inner cells reach only owned cells, the frame around them reaches into the halo
+	const size_t firstColumn = 2 * halo;
+	const size_t lastColumn = std::max(2 * halo, region.width);
+	const size_t firstRow = 2 * halo;
+	const size_t lastRow = std::max(2 * halo, region.height);
+	evolveRect(firstColumn, lastColumn, firstRow, lastRow);
+
+	std::exception_ptr receiveError;
+	try {
+		for (size_t direction = 0; direction < DIRECTIONS; direction++) {
+			const size_t side = opposite(direction);
+			const long long peer = neighbours[side];
+			if (peer < 0 || static_cast<size_t>(peer) == rank) continue;
+			const CellRegion rect = haloOf(side);
+			incoming.resize(rect.width * rect.height * sizeof(Cell));
+			transport.receive(static_cast<size_t>(peer), incoming.data(), incoming.size());
+			unpack(rect, incoming);
+		}
+	}
+	catch (...) {
+		receiveError = std::current_exception();
+		//the sender may be blocked by a process waiting for this one
+		transport.shutdown();
+	}
+	if (remote) {
+		std::unique_lock<std::mutex> lock(senderMutex);
+		sendFinished.wait(lock, [this] { return !sending; });
+	}
+	if (receiveError) std::rethrow_exception(receiveError);
+	if (sendError) std::rethrow_exception(sendError);
+
+	const size_t left = halo;
+	const size_t right = halo + region.width;
+	evolveRect(left, right, halo, firstRow);
+	evolveRect(left, right, lastRow, halo + region.height);
+	evolveRect(left, firstColumn, firstRow, lastRow);
+	evolveRect(lastColumn, right, firstRow, lastRow);
+	cells.swap(nextCells);
+	generation++;
+}
+
+void DistributedGrid::doOneEvolution() {
+	if (cells.getCellSize() == 1) evolve<uint8_t>();
+	else evolve<uint16_t>();
+}
+
+void DistributedGrid::doEvolutions(const unsigned long long generations) {
+	for (unsigned long long i = 0; i < generations; i++) doOneEvolution();
+}
+
+std::vector<uint64_t> DistributedGrid::gatherPopulation() {
+	std::vector<uint64_t> population(stateCount, 0);
+	for (size_t y = region.y; y < region.y + region.height; y++) {
+		for (size_t x = region.x; x < region.x + region.width; x++) population[getCellTypeAt(x, y)]++;
+	}
+	const size_t bytes = population.size() * sizeof(uint64_t);
+	if (transport.getRank() != 0) {
+		transport.send(0, population.data(), bytes);
+		return population;
+	}
+	std::vector<uint64_t> counts(stateCount);
+	for (size_t process = 1; process < transport.getSize(); process++) {
+		transport.receive(process, counts.data(), bytes);
+		for (size_t type = 0; type < stateCount; type++) population[type] += counts[type];
+	}
+	return population;
+}
+
+void DistributedGrid::gather(const std::function<void(const std::vector<size_t>& row)>& writeRow) {
+	const size_t rank = transport.getRank();
+	if (rank != 0) {
+		//rows are sent in the order the first process asks for them, waiting while it writes the rows above
+		for (size_t y = 0; y < region.height; y++) {
+			pack({ halo, halo + y, region.width, 1 }, outgoing[0]);
+			transport.send(0, outgoing[0].data(), outgoing[0].size());
+		}
+		return;
+	}
+	const size_t cellSize = cells.getCellSize();
+	std::vector<size_t> row(width);
+	for (size_t regionRow = 0; regionRow < rows; regionRow++) {
+		const CellRegion band = regionOf(regionRow * columns);
+		for (size_t y = band.y; y < band.y + band.height; y++) {
+			for (size_t column = 0; column < columns; column++) {
+				const size_t process = regionRow * columns + column;
+				const CellRegion part = regionOf(process);
+				if (process == rank) pack({ halo, halo + y - region.y, region.width, 1 }, incoming);
+				else {
+					incoming.resize(part.width * cellSize);
+					transport.receive(process, incoming.data(), incoming.size());
+				}
+				for (size_t x = 0; x < part.width; x++) {
+					if (cellSize == 1) row[part.x + x] = incoming[x];
+					else {
+						uint16_t type = 0;
+						std::memcpy(&type, incoming.data() + x * cellSize, cellSize);
+						row[part.x + x] = type;
+					}
+				}
+			}
+			writeRow(row);
+		}
+	}
+}
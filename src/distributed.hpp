@@ -0,0 +1,182 @@
+#ifndef AUTOMAT_DISTRIBUTED
+#define AUTOMAT_DISTRIBUTED
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+#include "automat.hpp"
+#include "cellbuffer.hpp"
+#include "activetiles.hpp"
+#include "cellsampler.hpp"
+#include "halotransport.hpp"
+
+/// @brief Grid of an automat split into rectangular regions, one per process of a transport.
+/// Every process holds and evolves only its own region surrounded by a halo as wide as the neighbourhood radius,
+/// the whole grid exists nowhere, cells are set region by region and collected row by row.
+/// Each generation the cells along the edges of the region are sent to the neighbouring processes
+/// while the inner part of the region, which needs no cells of other processes, is evolved,
+/// so the results are identical to evolving the whole grid in one automat, wrapping around borders included.
+class DistributedGrid {
+public:
+    /// @brief amount of neighbouring regions
+    static constexpr size_t DIRECTIONS = 8;
+
+private:
+    /// @brief rules compiled for fast lookup, copied from the automat
+    TransitionTable transitions;
+    /// @brief draws cell types with the probabilities of the cell definitions
+    CellSampler sampler;
+    /// @brief amount of cell types, the next index marks fixed borders
+    size_t stateCount = 0;
+    /// @brief width of the halo around the region, the radius of the neighbourhood
+    size_t halo = 1;
+    /// @brief true if the grid wraps around borders
+    bool overflowEdges = true;
+    /// @brief size of the whole grid
+    size_t width = 0;
+    size_t height = 0;
+    /// @brief amount of regions along each axis, their product is the amount of processes
+    size_t columns = 1;
+    size_t rows = 1;
+    /// @brief processes exchanging cells
+    HaloTransport& transport;
+    /// @brief cells of the whole grid owned by this process
+    CellRegion region{};
+    /// @brief owned cells surrounded by the halo, one cell type index per cell
+    CellBuffer cells;
+    /// @brief buffer the next generation is written into, swapped with cells after each evolution
+    CellBuffer nextCells;
+    /// @brief rank of the process owning the neighbouring region in each direction, -1 beyond fixed borders
+    std::array<long long, DIRECTIONS> neighbours{};
+    /// @brief cells sent to each neighbour, packed row by row
+    std::array<std::vector<uint8_t>, DIRECTIONS> outgoing;
+    /// @brief cells received from a neighbour, packed row by row
+    std::vector<uint8_t> incoming;
+    /// @brief amount of evolutions since construction
+    uint64_t generation = 0;
+
+    /// @brief guards the members below
+    std::mutex senderMutex;
+    /// @brief signals the sender that edges are packed or that it has to finish
+    std::condition_variable sendStarted;
+    /// @brief signals the evolving thread that the edges were sent
+    std::condition_variable sendFinished;
+    /// @brief edges of the current generation are packed and not sent yet
+    bool sending = false;
+    /// @brief sender has to finish
+    bool stopping = false;
+    /// @brief error of the last send, the transport is shut down when it is set
+    std::exception_ptr sendError;
+    /// @brief thread sending the edges to the neighbours, only started if one of them is another process
+    std::thread sender;
+
+    /// @brief main loop of the sender thread
+    void send();
+
+    /// @brief distance between rows of the haloed region
+    size_t getStride() const { return region.width + 2 * halo; }
+
+    /// @brief Region of the whole grid owned by a process
+    /// @param rank number of the process
+    CellRegion regionOf(const size_t rank) const;
+
+    /// @brief Owned cells along the edge facing a neighbour, in coordinates of the haloed region
+    /// @param direction index into the directions
+    CellRegion edgeOf(const size_t direction) const;
+
+    /// @brief Halo cells coming from a neighbour, in coordinates of the haloed region
+    /// @param direction index into the directions
+    CellRegion haloOf(const size_t direction) const;
+
+    /// @brief Copy rectangle of the haloed region into a packed buffer
+    void pack(const CellRegion& rect, std::vector<uint8_t>& buffer) const;
+
+    /// @brief Copy packed buffer into a rectangle of the haloed region
+    void unpack(const CellRegion& rect, const std::vector<uint8_t>& buffer);
+
+    /// @brief Exchange halos and evolve the region
+    /// @tparam Cell integer type of cells matching CellBuffer::cellSizeFor(stateCount + 1)
+    template<typename Cell>
+    void evolve();
+
+public:
+    /// @brief Split grid among the processes of a transport, the region of this process is filled with the first cell type.
+    /// Every process has to construct the grid with equal arguments. Regions are chosen to keep the halos short.
+    /// @param automat automat defining the cell types, rules, neighbourhood and borders, its grid is not used and may be the smallest one
+    /// @param gridWidth width of the whole grid
+    /// @param gridHeight height of the whole grid
+    /// @param transport processes sharing the grid, has to outlive the grid
+    /// @throws Automat::InvalidFormatException if regions would be narrower than the neighbourhood radius
+    DistributedGrid(const Automat& automat, const size_t gridWidth, const size_t gridHeight, HaloTransport& transport);
+
+    /// @brief stop and join the sender thread
+    ~DistributedGrid();
+
+    DistributedGrid(const DistributedGrid&) = delete;
+    DistributedGrid& operator=(const DistributedGrid&) = delete;
+
+    /// @brief Split grid into regions as square as possible, the length of the halos grows with the cut through the grid
+    /// @param gridWidth width of the whole grid
+    /// @param gridHeight height of the whole grid
+    /// @param radius radius of the neighbourhood
+    /// @param processes amount of regions
+    /// @return std::pair (success, (columns, rows)), fails if regions would be narrower than the neighbourhood radius
+    static std::pair<bool, std::pair<size_t, size_t>> chooseLayout(const size_t gridWidth, const size_t gridHeight,
+        const size_t radius, const size_t processes);
+
+    /// @brief cells of the whole grid owned by this process
+    const CellRegion& getRegion() const { return region; }
+
+    /// @brief amount of regions along x and y
+    std::pair<size_t, size_t> getLayout() const { return { columns, rows }; }
+
+    /// @brief get type of owned cell at coordinates of the whole grid
+    size_t getCellTypeAt(const size_t x, const size_t y) const;
+
+    /// @brief set type of owned cell at coordinates of the whole grid
+    void setCellTypeAt(const size_t x, const size_t y, const size_t type);
+
+    /// @brief Set run of cells in one row of the whole grid, only the owned part of the run is set.
+    /// Every process can be given all cells of the grid, each one keeps its own.
+    /// @param x first column of the run
+    /// @param y row of the run
+    /// @param length amount of cells, the run has to lie inside the row
+    /// @param type index of cell type
+    void setCellRun(const size_t x, const size_t y, const size_t length, const size_t type);
+
+    /// @brief Set owned cells to random types, the whole grid is equal to Automat::randomizeCells(seed) on a grid of the same size
+    /// @param seed seed of the random numbers, equal in all processes
+    void randomizeCells(const uint64_t seed);
+
+    /// @brief Run one evolution of cells, all processes have to call it together
+    /// @throws std::runtime_error if a neighbour can't be reached, the transport is shut down so the other processes fail too
+    void doOneEvolution();
+
+    /// @brief Run several evolutions of cells, all processes have to call it together
+    /// @param generations amount of evolutions
+    /// @throws std::runtime_error if a neighbour can't be reached
+    void doEvolutions(const unsigned long long generations);
+
+    /// @brief amount of evolutions since construction
+    uint64_t getGeneration() const { return generation; }
+
+    /// @brief Count cells of each type in all regions, all processes have to call it together
+    /// @return amount of cells of each type in the whole grid for the process of rank 0, in the own region for the others
+    /// @throws std::runtime_error if a process can't be reached
+    std::vector<uint64_t> gatherPopulation();
+
+    /// @brief Pass the rows of the whole grid to the process of rank 0 one by one, all processes have to call it together.
+    /// Only one row of the grid is held at a time, processes send each row of their region when it is needed.
+    /// @param writeRow called by the process of rank 0 with the cell types of each row from top to bottom
+    /// @throws std::runtime_error if a process can't be reached
+    void gather(const std::function<void(const std::vector<size_t>& row)>& writeRow);
+};
+
+#endif // !AUTOMAT_DISTRIBUTED
@@ -0,0 +1,87 @@
+#ifndef AUTOMAT_GRIDHASH
+#define AUTOMAT_GRIDHASH
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+#include "cellsampler.hpp"
+
+/// @brief Zobrist hash of a grid together with the hashes of recent generations.
+/// Every cell not of the first type contributes a random key depending on its position and type,
+/// the hash is the XOR of all keys, so a changed cell changes it by two keys regardless of the grid size.
+/// Keys come from a counter based generator and are not stored.
+class GridHash {
+private:
+    /// @brief hash of the current grid
+    uint64_t hash = 0;
+    /// @brief ring of hashes of recent generations
+    std::vector<uint64_t> history;
+    /// @brief position in history the next hash is written to
+    size_t newest = 0;
+    /// @brief amount of valid hashes in history
+    size_t recorded = 0;
+    /// @brief generations since the last occurrence of the current hash, 0 if it is not in history
+    unsigned long long period = 0;
+
+public:
+    /// @brief amount of generations remembered by default, longest period that is detected
+    static constexpr size_t DEFAULT_HISTORY = 64;
+
+    /// @brief Hash tracking grids
+    /// @param historyLength amount of generations remembered, at least 1
+    explicit GridHash(const size_t historyLength = DEFAULT_HISTORY)
+        : history(std::max<size_t>(1, historyLength), 0) {
+    }
+
+    /// @brief Key of a cell, zero for the first type so empty regions cost nothing
+    /// @param index position of the cell, y * width + x
+    /// @param type index of the cell type
+    static uint64_t key(const uint64_t index, const size_t type) {
+        if (type == 0) return 0;
+        return CellSampler::random(static_cast<uint64_t>(type) * 0xD1B54A32D192ED03ull, index);
+    }
+
+    /// @brief amount of generations remembered
+    size_t getHistoryLength() const { return history.size(); }
+
+    /// @brief hash of the current grid
+    uint64_t get() const { return hash; }
+
+    /// @brief replace hash after the grid was recomputed as a whole
+    void set(const uint64_t value) { hash = value; }
+
+    /// @brief apply XOR of keys of changed cells
+    void toggle(const uint64_t keys) { hash ^= keys; }
+
+    /// @brief true if no generation is remembered, after construction and forget
+    bool empty() const { return recorded == 0; }
+
+    /// @brief Drop remembered generations, edits break the chain of evolutions leading to the current grid
+    void forget() {
+        recorded = 0;
+        period = 0;
+    }
+
+    /// @brief Remember current hash as the next generation and look it up in the previous ones
+    void record() {
+        const size_t length = history.size();
+        period = 0;
+        for (size_t back = 1; back <= recorded; back++) {
+            if (history[(newest + length - back) % length] == hash) {
+                period = back;
+                break;
+            }
+        }
+        history[newest] = hash;
+        newest = (newest + 1) % length;
+        recorded = std::min(recorded + 1, length);
+    }
+
+    /// @brief Period of the current grid
+    /// @return std::pair (success, period), fails if the grid did not occur among the remembered generations
+    std::pair<bool, unsigned long long> getPeriod() const { return { period > 0, period }; }
+};
+
+#endif // !AUTOMAT_GRIDHASH
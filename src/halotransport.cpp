@@ -0,0 +1,148 @@
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+#include "halotransport.hpp"
+
+#ifdef _WIN32
+
+std::pair<bool, std::string> SocketTransport::start(const size_t processes) {
+	if (processes <= 1) return { true, "" };
+	return { false, "Running several processes is not supported on this system" };
+}
+
+std::pair<bool, std::string> SocketTransport::join() {
+	return { true, "" };
+}
+
+void SocketTransport::close() {
+}
+
+void SocketTransport::send(const size_t peer, const void* data, const size_t size) {
+	throw std::runtime_error("Process " + std::to_string(peer) + " can't be reached");
+}
+
+void SocketTransport::receive(const size_t peer, void* data, const size_t size) {
+	throw std::runtime_error("Process " + std::to_string(peer) + " can't be reached");
+}
+
+void SocketTransport::shutdown() {
+}
+
+#else
+
+std::pair<bool, std::string> SocketTransport::start(const size_t processes) {
+	if (processes <= 1) return { true, "" };
+	//pairs[i][j] is the end process i keeps of the pair connecting i and j
+	std::vector<std::vector<int>> pairs(processes, std::vector<int>(processes, -1));
+	auto closeAll = [&pairs]() {
+		for (std::vector<int>& row : pairs) {
+			for (int& socket : row) {
+				if (socket >= 0) ::close(socket);
+				socket = -1;
+			}
+		}
+	};
+	for (size_t i = 0; i < processes; i++) {
+		for (size_t j = i + 1; j < processes; j++) {
+			int ends[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+				closeAll();
+				return { false, "Can't create socket pair" };
+			}
+			pairs[i][j] = ends[0];
+			pairs[j][i] = ends[1];
+		}
+	}
+	//buffered output would be written again by every copy
+	std::fflush(nullptr);
+	for (size_t process = 1; process < processes; process++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			//started copies see their connections closed and fail
+			closeAll();
+			join();
+			return { false, "Can't start process" };
+		}
+		if (pid == 0) {
+			rank = process;
+			children.clear();
+			break;
+		}
+		children.push_back(static_cast<long long>(pid));
+	}
+	//every process keeps only its own ends
+	sockets.assign(processes, -1);
+	for (size_t i = 0; i < processes; i++) {
+		for (size_t j = 0; j < processes; j++) {
+			if (i == rank) sockets[j] = pairs[i][j];
+			else if (pairs[i][j] >= 0) ::close(pairs[i][j]);
+		}
+	}
+	return { true, "" };
+}
+
+std::pair<bool, std::string> SocketTransport::join() {
+	bool success = true;
+	for (long long child : children) {
+		int status = 0;
+		while (waitpid(static_cast<pid_t>(child), &status, 0) < 0 && errno == EINTR) {}
+		success = success && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	children.clear();
+	if (!success) return { false, "A process failed" };
+	return { true, "" };
+}
+
+void SocketTransport::close() {
+	for (int& socket : sockets) {
+		if (socket >= 0) ::close(socket);
+		socket = -1;
+	}
+}
+
+void SocketTransport::send(const size_t peer, const void* data, const size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	size_t sent = 0;
+	while (sent < size) {
+#ifdef MSG_NOSIGNAL
+		ssize_t written = ::send(sockets[peer], bytes + sent, size - sent, MSG_NOSIGNAL);
+#else
+		ssize_t written = ::send(sockets[peer], bytes + sent, size - sent, 0);
+#endif
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0) throw std::runtime_error("Process " + std::to_string(peer) + " can't be reached");
+		sent += static_cast<size_t>(written);
+	}
+}
+
+void SocketTransport::receive(const size_t peer, void* data, const size_t size) {
+	uint8_t* bytes = static_cast<uint8_t*>(data);
+	size_t received = 0;
+	while (received < size) {
+		ssize_t read = ::recv(sockets[peer], bytes + received, size - received, 0);
+		if (read < 0 && errno == EINTR) continue;
+		if (read <= 0) throw std::runtime_error("Process " + std::to_string(peer) + " can't be reached");
+		received += static_cast<size_t>(read);
+	}
+}
+
+void SocketTransport::shutdown() {
+	//sockets stay open so other threads never use a reused descriptor, blocked calls return and peers read the end
+	for (int socket : sockets) {
+		if (socket >= 0) ::shutdown(socket, SHUT_RDWR);
+	}
+}
+
+#endif
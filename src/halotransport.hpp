@@ -0,0 +1,82 @@
+#ifndef AUTOMAT_HALOTRANSPORT
+#define AUTOMAT_HALOTRANSPORT
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/// @brief Channel between the processes of a distributed run, numbered by rank from 0.
+/// Messages between two processes arrive in the order they were sent, sending and receiving may happen on different threads.
+class HaloTransport {
+public:
+    virtual ~HaloTransport() = default;
+
+    /// @brief number of this process
+    virtual size_t getRank() const = 0;
+
+    /// @brief amount of processes
+    virtual size_t getSize() const = 0;
+
+    /// @brief Send message to another process, returns when the data may be reused
+    /// @param peer rank of the receiver, not this process
+    /// @param data first byte of the message
+    /// @param size size of the message in bytes
+    /// @throws std::runtime_error if the peer can't be reached
+    virtual void send(const size_t peer, const void* data, const size_t size) = 0;
+
+    /// @brief Receive message from another process, waits until all of it arrived
+    /// @param peer rank of the sender, not this process
+    /// @param data buffer of at least size bytes
+    /// @param size size of the message in bytes, equal to the size the peer sent
+    /// @throws std::runtime_error if the peer can't be reached
+    virtual void receive(const size_t peer, void* data, const size_t size) = 0;
+
+    /// @brief Stop all communication of this process, may be called from any thread.
+    /// Sends and receives waiting or started later fail, so do those of processes waiting for this one.
+    virtual void shutdown() = 0;
+};
+
+/// @brief Processes on one machine started by fork and connected by a Unix socket pair between every two of them.
+/// Only available on POSIX systems.
+class SocketTransport : public HaloTransport {
+private:
+    /// @brief number of this process
+    size_t rank = 0;
+    /// @brief socket connected to each process, -1 for this process
+    std::vector<int> sockets;
+    /// @brief process ids of the started processes, only known to rank 0
+    std::vector<long long> children;
+
+    /// @brief close all sockets
+    void close();
+
+public:
+    /// @brief transport of a single process
+    SocketTransport() : sockets(1, -1) {}
+
+    /// @brief close sockets, processes that are still running see the connection closed
+    ~SocketTransport() override { close(); }
+
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    /// @brief Start copies of the calling process, every process continues after this call with its own rank.
+    /// The calling process gets rank 0. Has to be called before other threads are started,
+    /// copies contain only the calling thread. Output buffered by the C library is flushed first so it is not repeated.
+    /// @param processes amount of processes including the calling one
+    /// @return std::pair (success, error_message), fails without starting processes
+    std::pair<bool, std::string> start(const size_t processes);
+
+    /// @brief Wait until all started processes exited, called by rank 0 after closing the transport is not needed
+    /// @return std::pair (success, error_message), fails if a process exited unsuccessfully
+    std::pair<bool, std::string> join();
+
+    size_t getRank() const override { return rank; }
+    size_t getSize() const override { return sockets.size(); }
+    void send(const size_t peer, const void* data, const size_t size) override;
+    void receive(const size_t peer, void* data, const size_t size) override;
+    void shutdown() override;
+};
+
+#endif // !AUTOMAT_HALOTRANSPORT
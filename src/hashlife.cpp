@@ -0,0 +1,211 @@
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+
+#include "hashlife.hpp"
+
+size_t HashLife::NodeKeyHash::operator()(const NodeKey& key) const {
+	uint64_t hash = key.nw;
+	hash = hash * 0x9E3779B97F4A7C15ULL + key.ne;
+	hash = hash * 0x9E3779B97F4A7C15ULL + key.sw;
+	hash = hash * 0x9E3779B97F4A7C15ULL + key.se;
+	return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+HashLife::HashLife(const Automat& automat) {
+	auto [binary, binaryRule] = automat.getBinaryRule();
+	if (!binary) throw Automat::InvalidFormatException("HashLife requires two cell types and rules counting the 8 Moore neighbours in state 1!");
+	//empty space has to stay empty, the universe is unbounded
+	if (binaryRule.toOne[0] & 1) throw Automat::InvalidFormatException("HashLife can't evolve rules where cells with no neighbours in state 1 become state 1!");
+	rule = binaryRule;
+
+	nodes.push_back(Node{ NONE, NONE, NONE, NONE, 0, NONE, 0 });
+	nodes.push_back(Node{ NONE, NONE, NONE, NONE, 0, NONE, 1 });
+	emptyNodes.push_back(DEAD);
+
+	uint32_t level = 3;
+	while ((1ULL << level) < std::max(automat.width, automat.height)) level++;
+	root = build(automat, level, 0, 0);
+}
+
+uint32_t HashLife::join(const uint32_t nw, const uint32_t ne, const uint32_t sw, const uint32_t se) {
+	NodeKey key{ nw, ne, sw, se };
+	auto found = nodeIndex.find(key);
+	if (found != nodeIndex.end()) return found->second;
+	uint64_t population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+	uint32_t id = static_cast<uint32_t>(nodes.size());
+	nodes.push_back(Node{ nw, ne, sw, se, nodes[nw].level + 1, NONE, population });
+	nodeIndex.emplace(key, id);
+	return id;
+}
+
+uint32_t HashLife::empty(const uint32_t level) {
+	while (emptyNodes.size() <= level) {
+		uint32_t child = emptyNodes.back();
+		emptyNodes.push_back(join(child, child, child, child));
+	}
+	return emptyNodes[level];
+}
+
+uint32_t HashLife::centre(const uint32_t node) {
+	const Node n = nodes[node];
+	return join(nodes[n.nw].se, nodes[n.ne].sw, nodes[n.sw].ne, nodes[n.se].nw);
+}
+
+uint32_t HashLife::evolveBase(const uint32_t node) {
+	//read 4x4 cells, bit y * 4 + x
+	uint32_t bits = 0;
+	const Node n = nodes[node];
+	const uint32_t quadrants[4] = { n.nw, n.ne, n.sw, n.se };
+	for (uint32_t q = 0; q < 4; q++) {
+		const Node quadrant = nodes[quadrants[q]];
+		const uint32_t cells[4] = { quadrant.nw, quadrant.ne, quadrant.sw, quadrant.se };
+		for (uint32_t c = 0; c < 4; c++) {
+			uint32_t x = (q % 2) * 2 + c % 2;
+			uint32_t y = (q / 2) * 2 + c / 2;
+			if (cells[c] == ALIVE) bits |= 1u << (y * 4 + x);
+		}
+	}
+	//apply rule to the 2x2 centre
+	uint32_t result[4];
+	for (uint32_t c = 0; c < 4; c++) {
+		uint32_t x = 1 + c % 2;
+		uint32_t y = 1 + c / 2;
+		unsigned int neighbours = 0;
+		for (uint32_t ny = y - 1; ny <= y + 1; ny++) {
+			for (uint32_t nx = x - 1; nx <= x + 1; nx++) {
+				if ((nx != x || ny != y) && (bits >> (ny * 4 + nx) & 1)) neighbours++;
+			}
+		}
+		uint32_t state = bits >> (y * 4 + x) & 1;
+		result[c] = (rule.toOne[state] >> neighbours & 1) ? ALIVE : DEAD;
+	}
+	return join(result[0], result[1], result[2], result[3]);
+}
+
+uint32_t HashLife::successor(const uint32_t node, const uint32_t step) {
+	const Node n = nodes[node];
+	if (n.population == 0) return empty(n.level - 1);
+	const bool full = step + 2 == n.level;
+	if (full && n.result != NONE) return n.result;
+	const uint64_t partialKey = (static_cast<uint64_t>(node) << 6) | step;
+	if (!full) {
+		auto found = partialResults.find(partialKey);
+		if (found != partialResults.end()) return found->second;
+	}
+
+	uint32_t result;
+	if (n.level == 2) {
+		result = evolveBase(node);
+	}
+	else {
+		const Node nw = nodes[n.nw], ne = nodes[n.ne], sw = nodes[n.sw], se = nodes[n.se];
+		//nine overlapping subnodes of level - 1
+		uint32_t sub[3][3] = {
+			{ n.nw, join(nw.ne, ne.nw, nw.se, ne.sw), n.ne },
+			{ join(nw.sw, nw.se, sw.nw, sw.ne), join(nw.se, ne.sw, sw.ne, se.nw), join(ne.sw, ne.se, se.nw, se.ne) },
+			{ n.sw, join(sw.ne, se.nw, sw.se, se.sw), n.se }
+		};
+		//full speed advances twice by half of the time, otherwise only the second half advances
+		const uint32_t innerStep = full ? n.level - 3 : step;
+		for (auto& row : sub) {
+			for (uint32_t& subnode : row) {
+				subnode = full ? successor(subnode, n.level - 3) : centre(subnode);
+			}
+		}
+		uint32_t nwResult = successor(join(sub[0][0], sub[0][1], sub[1][0], sub[1][1]), innerStep);
+		uint32_t neResult = successor(join(sub[0][1], sub[0][2], sub[1][1], sub[1][2]), innerStep);
+		uint32_t swResult = successor(join(sub[1][0], sub[1][1], sub[2][0], sub[2][1]), innerStep);
+		uint32_t seResult = successor(join(sub[1][1], sub[1][2], sub[2][1], sub[2][2]), innerStep);
+		result = join(nwResult, neResult, swResult, seResult);
+	}
+
+	if (full) nodes[node].result = result;
+	else partialResults.emplace(partialKey, result);
+	return result;
+}
+
+void HashLife::expand() {
+	const Node r = nodes[root];
+	const uint32_t border = empty(r.level - 1);
+	uint32_t nw = join(border, border, border, r.nw);
+	uint32_t ne = join(border, border, r.ne, border);
+	uint32_t sw = join(border, r.sw, border, border);
+	uint32_t se = join(r.se, border, border, border);
+	root = join(nw, ne, sw, se);
+	originX -= 1LL << (r.level - 1);
+	originY -= 1LL << (r.level - 1);
+}
+
+void HashLife::stepPow2(const unsigned int exponent) {
+	//cells travel at most one cell per generation, keep them inside the centre of the centre
+	//so nothing escapes the half of the root the result covers
+	while (true) {
+		const Node r = nodes[root];
+		if (r.level >= exponent + 3) {
+			const Node nw = nodes[r.nw], ne = nodes[r.ne], sw = nodes[r.sw], se = nodes[r.se];
+			uint64_t inner = nodes[nodes[nw.se].se].population + nodes[nodes[ne.sw].sw].population
+				+ nodes[nodes[sw.ne].ne].population + nodes[nodes[se.nw].nw].population;
+			if (inner == r.population) break;
+		}
+		expand();
+	}
+	const uint32_t level = nodes[root].level;
+	root = successor(root, exponent);
+	originX += 1LL << (level - 2);
+	originY += 1LL << (level - 2);
+	generation += 1ULL << exponent;
+}
+
+void HashLife::advance(uint64_t generations) {
+	for (unsigned int exponent = 0; generations > 0; exponent++, generations >>= 1) {
+		if (generations & 1) stepPow2(exponent);
+	}
+}
+
+uint32_t HashLife::build(const Automat& automat, const uint32_t level, const long long x, const long long y) {
+	const long long size = 1LL << level;
+	if (x >= static_cast<long long>(automat.width) || y >= static_cast<long long>(automat.height) || x + size <= 0 || y + size <= 0) {
+		return empty(level);
+	}
+	if (level == 0) {
+		return automat.getCellTypeAt(static_cast<size_t>(x), static_cast<size_t>(y)) == 1 ? ALIVE : DEAD;
+	}
+	const long long half = size / 2;
+	uint32_t nw = build(automat, level - 1, x, y);
+	uint32_t ne = build(automat, level - 1, x + half, y);
+	uint32_t sw = build(automat, level - 1, x, y + half);
+	uint32_t se = build(automat, level - 1, x + half, y + half);
+	return join(nw, ne, sw, se);
+}
+
+void HashLife::extract(const uint32_t node, const long long x, const long long y, Automat& automat) const {
+	const Node& n = nodes[node];
+	const long long size = 1LL << n.level;
+	if (n.population == 0) return;
+	if (x >= static_cast<long long>(automat.width) || y >= static_cast<long long>(automat.height) || x + size <= 0 || y + size <= 0) {
+		return;
+	}
+	if (n.level == 0) {
+		automat.setCellTypeAt(static_cast<size_t>(x), static_cast<size_t>(y), 1);
+		return;
+	}
+	const long long half = size / 2;
+	extract(n.nw, x, y, automat);
+	extract(n.ne, x + half, y, automat);
+	extract(n.sw, x, y + half, automat);
+	extract(n.se, x + half, y + half, automat);
+}
+
+void HashLife::writeTo(Automat& automat) const {
+	automat.clearCells();
+	extract(root, originX, originY, automat);
+}
+
+void HashLife::clearCache() {
+	partialResults.clear();
+	for (Node& node : nodes) {
+		node.result = NONE;
+	}
+}
@@ -0,0 +1,122 @@
+#ifndef AUTOMAT_HASHLIFE
+#define AUTOMAT_HASHLIFE
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "automat.hpp"
+#include "bitgrid.hpp"
+
+/// @brief HashLife engine for two state automata,
+/// stores an unbounded universe as a hash consed quadtree and memoises future results of its nodes
+class HashLife {
+private:
+    /// @brief Quadtree node of level k covering 2^k x 2^k cells, level 0 nodes are single cells
+    struct Node {
+        uint32_t nw, ne, sw, se;
+        uint32_t level;
+        /// @brief centre advanced by 2^(level-2) generations, NONE if not computed yet
+        uint32_t result;
+        /// @brief amount of cells in state 1
+        uint64_t population;
+    };
+
+    /// @brief Children of a node, key of the hash consing table
+    struct NodeKey {
+        uint32_t nw, ne, sw, se;
+        bool operator==(const NodeKey& other) const {
+            return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+        }
+    };
+
+    /// @brief hash of children of a node
+    struct NodeKeyHash {
+        size_t operator()(const NodeKey& key) const;
+    };
+
+    /// @brief id of a missing node
+    static constexpr uint32_t NONE = UINT32_MAX;
+    /// @brief ids of the two level 0 nodes
+    static constexpr uint32_t DEAD = 0;
+    static constexpr uint32_t ALIVE = 1;
+
+    /// @brief all nodes ever created, indexed by id
+    std::vector<Node> nodes;
+    /// @brief maps children to the unique node having them
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> nodeIndex;
+    /// @brief results of nodes advanced by less than 2^(level-2) generations, keyed by id and step exponent
+    std::unordered_map<uint64_t, uint32_t> partialResults;
+    /// @brief node with no cells in state 1 for every level
+    std::vector<uint32_t> emptyNodes;
+
+    /// @brief rule applied to every cell
+    BinaryRule rule;
+    /// @brief root of the universe
+    uint32_t root = DEAD;
+    /// @brief coordinates of the top left cell of the root
+    long long originX = 0;
+    long long originY = 0;
+    /// @brief amount of generations the universe was advanced by
+    uint64_t generation = 0;
+
+    /// @brief unique node with given children
+    uint32_t join(const uint32_t nw, const uint32_t ne, const uint32_t sw, const uint32_t se);
+
+    /// @brief unique empty node of level
+    uint32_t empty(const uint32_t level);
+
+    /// @brief node of level - 1 made of the centre of a node
+    uint32_t centre(const uint32_t node);
+
+    /// @brief centre of a level 2 node advanced by one generation, evaluated cell by cell
+    uint32_t evolveBase(const uint32_t node);
+
+    /// @brief centre of a node advanced by 2^step generations
+    /// @param node node of level at least step + 2
+    /// @param step exponent of the amount of generations
+    /// @return node of level - 1
+    uint32_t successor(const uint32_t node, const uint32_t step);
+
+    /// @brief surround root by empty space, doubling its size
+    void expand();
+
+    /// @brief build node from cells of automat, cells outside of the grid are in state 0
+    uint32_t build(const Automat& automat, const uint32_t level, const long long x, const long long y);
+
+    /// @brief write cells in state 1 of a node into automat
+    void extract(const uint32_t node, const long long x, const long long y, Automat& automat) const;
+
+public:
+    /// @brief HashLife constructor, copies rules and cells of automat,
+    /// grid coordinates become universe coordinates
+    /// @param automat two state automat expressible as BinaryRule
+    HashLife(const Automat& automat);
+
+    /// @brief Advance the universe by 2^exponent generations
+    /// @param exponent exponent of the amount of generations, at most 60
+    void stepPow2(const unsigned int exponent);
+
+    /// @brief Advance the universe by any amount of generations
+    /// @param generations amount of generations
+    void advance(uint64_t generations);
+
+    /// @brief amount of generations the universe was advanced by
+    uint64_t getGeneration() const { return generation; }
+
+    /// @brief amount of cells in state 1
+    uint64_t getPopulation() const { return nodes[root].population; }
+
+    /// @brief amount of distinct nodes created
+    size_t getNodeCount() const { return nodes.size(); }
+
+    /// @brief Write part of the universe covered by the automat grid into its cells,
+    /// cells of the universe outside of the grid are lost
+    /// @param automat automat with the same cell types
+    void writeTo(Automat& automat) const;
+
+    /// @brief Forget memoised results to free memory, nodes of the current universe stay valid
+    void clearCache();
+};
+
+#endif // !AUTOMAT_HASHLIFE
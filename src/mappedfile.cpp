@@ -0,0 +1,83 @@
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+	file = handle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		close();
+		throw std::runtime_error("Can't read size of " + path);
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+	//empty files can't be mapped
+	if (length == 0) return;
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		close();
+		throw std::runtime_error("Can't map " + path);
+	}
+	bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!bytes) {
+		close();
+		throw std::runtime_error("Can't map " + path);
+	}
+}
+
+void MappedFile::close() {
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	bytes = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+	descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) throw std::runtime_error("Can't open " + path);
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) {
+		close();
+		throw std::runtime_error("Can't read size of " + path);
+	}
+	length = static_cast<size_t>(status.st_size);
+	//empty files can't be mapped
+	if (length == 0) return;
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (mapped == MAP_FAILED) {
+		close();
+		throw std::runtime_error("Can't map " + path);
+	}
+	bytes = static_cast<const uint8_t*>(mapped);
+	//snapshots are read front to back
+	madvise(mapped, length, MADV_SEQUENTIAL);
+}
+
+void MappedFile::close() {
+	if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+	if (descriptor >= 0) ::close(descriptor);
+	bytes = nullptr;
+	descriptor = -1;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef AUTOMAT_MAPPEDFILE
+#define AUTOMAT_MAPPEDFILE
+
+#include <string>
+#include <cstdint>
+
+/// @brief Whole file mapped read only into memory, pages are loaded when they are first accessed
+class MappedFile {
+private:
+    /// @brief first byte of the mapping, nullptr for empty files
+    const uint8_t* bytes = nullptr;
+    /// @brief size of the file
+    size_t length = 0;
+#ifdef _WIN32
+    /// @brief handles of the file and its mapping
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    /// @brief descriptor of the file
+    int descriptor = -1;
+#endif
+
+    /// @brief unmap and close the file
+    void close();
+
+public:
+    /// @brief Map file into memory
+    /// @param path path to the file
+    /// @throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+
+    /// @brief unmap the file
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief content of the file
+    const uint8_t* data() const { return bytes; }
+
+    /// @brief size of the file in bytes
+    size_t size() const { return length; }
+};
+
+#endif // !AUTOMAT_MAPPEDFILE
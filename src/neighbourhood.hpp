@@ -0,0 +1,89 @@
+#ifndef AUTOMAT_NEIGHBOURHOOD
+#define AUTOMAT_NEIGHBOURHOOD
+
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+/// @brief Shapes of neighbourhoods
+enum class NeighbourhoodType {
+    /// @brief square of cells, (2r+1)^2 - 1 neighbours
+    moore,
+    /// @brief diamond of cells within Manhattan distance r, 2r(r+1) neighbours
+    vonNeumann,
+    /// @brief hexagon on a grid whose rows are shifted by half a cell, 3r(r+1) neighbours,
+    /// cells up right and down left are not neighbours at radius 1
+    hexagonal
+};
+
+/// @brief Cells whose states are counted by rules, every row of the neighbourhood is a contiguous span of cells
+struct Neighbourhood {
+    /// @brief largest radius, changes must not spread beyond neighbouring tiles in one generation
+    static constexpr unsigned int MAX_RADIUS = 16;
+
+    NeighbourhoodType type = NeighbourhoodType::moore;
+    unsigned int radius = 1;
+
+    /// @brief true for the 8 cell Moore neighbourhood all presets use
+    bool isMoore() const { return type == NeighbourhoodType::moore && radius == 1; }
+
+    /// @brief first column of the span in row dy relative to the cell
+    long long left(const long long dy) const {
+        const long long r = static_cast<long long>(radius);
+        if (type == NeighbourhoodType::vonNeumann) return -(r - std::abs(dy));
+        if (type == NeighbourhoodType::hexagonal) return std::max(-r, dy - r);
+        return -r;
+    }
+
+    /// @brief last column of the span in row dy relative to the cell
+    long long right(const long long dy) const {
+        const long long r = static_cast<long long>(radius);
+        if (type == NeighbourhoodType::vonNeumann) return r - std::abs(dy);
+        if (type == NeighbourhoodType::hexagonal) return std::min(r, dy + r);
+        return r;
+    }
+
+    /// @brief amount of neighbours, the cell itself is not counted
+    unsigned int size() const {
+        unsigned int cells = 0;
+        const long long r = static_cast<long long>(radius);
+        for (long long dy = -r; dy <= r; dy++) cells += static_cast<unsigned int>(right(dy) - left(dy) + 1);
+        return cells - 1;
+    }
+
+    bool operator==(const Neighbourhood& other) const { return type == other.type && radius == other.radius; }
+    bool operator!=(const Neighbourhood& other) const { return !(*this == other); }
+
+    /// @brief Text as used in rules, e.g. "VONNEUMANN,2"
+    std::string toString() const {
+        std::string name = type == NeighbourhoodType::vonNeumann ? "VONNEUMANN" : type == NeighbourhoodType::hexagonal ? "HEX" : "MOORE";
+        return name + "," + std::to_string(radius);
+    }
+
+    /// @brief Parse neighbourhood given as type and optional radius, e.g. "MOORE,3" or "hex"
+    /// @param text MOORE, VONNEUMANN or HEX in any case, followed by a comma and radius 1 to MAX_RADIUS (default 1)
+    /// @return std::pair (success, neighbourhood)
+    static std::pair<bool, Neighbourhood> parse(const std::string& text) {
+        Neighbourhood neighbourhood;
+        const size_t comma = text.find(',');
+        std::string name = text.substr(0, comma);
+        name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        if (name == "MOORE") neighbourhood.type = NeighbourhoodType::moore;
+        else if (name == "VONNEUMANN") neighbourhood.type = NeighbourhoodType::vonNeumann;
+        else if (name == "HEX") neighbourhood.type = NeighbourhoodType::hexagonal;
+        else return { false, neighbourhood };
+        if (comma == std::string::npos) return { true, neighbourhood };
+        std::string radius = text.substr(comma + 1);
+        radius.erase(std::remove(radius.begin(), radius.end(), ' '), radius.end());
+        if (radius.empty() || radius.size() > 2 || !std::all_of(radius.begin(), radius.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            return { false, neighbourhood };
+        }
+        neighbourhood.radius = static_cast<unsigned int>(std::stoul(radius));
+        return { neighbourhood.radius >= 1 && neighbourhood.radius <= MAX_RADIUS, neighbourhood };
+    }
+};
+
+#endif // !AUTOMAT_NEIGHBOURHOOD
@@ -0,0 +1,262 @@
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+
+#include "rle.hpp"
+
+namespace {
+
+/// @brief remove whitespace from both ends of a string
+std::string trim(const std::string& text) {
+	size_t first = text.find_first_not_of(" \t\r");
+	if (first == std::string::npos) return "";
+	size_t last = text.find_last_not_of(" \t\r");
+	return text.substr(first, last - first + 1);
+}
+
+/// @brief Parse number of the header line
+/// @return std::pair (success, number)
+std::pair<bool, size_t> parseSize(const std::string& text) {
+	if (text.empty() || !std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+		return { false, 0 };
+	}
+	try {
+		return { true, std::stoull(text) };
+	}
+	catch (const std::exception&) {
+		return { false, 0 };
+	}
+}
+
+/// @brief Tag of a state as written into a pattern
+/// @param state the state
+/// @param twoStates pattern uses 'b' and 'o'
+std::string stateTag(const size_t state, const bool twoStates) {
+	if (twoStates) return state ? "o" : "b";
+	if (state == 0) return ".";
+	if (state <= 24) return std::string(1, static_cast<char>('A' + state - 1));
+	return { static_cast<char>('p' + (state - 25) / 24), static_cast<char>('A' + (state - 25) % 24) };
+}
+
+} // namespace
+
+std::pair<bool, std::string> RlePattern::readHeader(std::istream& input, RleHeader& header) {
+	for (std::string line; std::getline(input, line); ) {
+		line = trim(line);
+		//skip empty lines
+		if (line.empty()) continue;
+		if (line[0] == '#') {
+			if (line.compare(0, std::string(STATES_COMMENT).size(), STATES_COMMENT) == 0) {
+				std::istringstream names(line.substr(std::string(STATES_COMMENT).size()));
+				header.stateNames.clear();
+				for (std::string name; names >> name; ) header.stateNames.push_back(name);
+			}
+			continue;
+		}
+		if (line[0] != 'x') return { false, "Missing header line (Correct example: x = 3, y = 3, rule = B3/S23)" };
+		bool hasWidth = false;
+		bool hasHeight = false;
+		for (const std::string& field : Automat::splitByDelim(line, ',')) {
+			size_t equals = field.find('=');
+			if (equals == std::string::npos) return { false, "Invalid header line:\n" + line };
+			std::string key = trim(field.substr(0, equals));
+			std::string value = trim(field.substr(equals + 1));
+			if (key == "x" || key == "y") {
+				auto [valid, size] = parseSize(value);
+				if (!valid) return { false, "Invalid pattern size in header line:\n" + line };
+				if (key == "x") {
+					header.width = size;
+					hasWidth = true;
+				}
+				else {
+					header.height = size;
+					hasHeight = true;
+				}
+			}
+			else if (key == "rule") header.rule = value;
+		}
+		if (!hasWidth || !hasHeight) return { false, "Header line has to contain x and y:\n" + line };
+		return { true, "" };
+	}
+	return { false, "Missing header line (Correct example: x = 3, y = 3, rule = B3/S23)" };
+}
+
+std::pair<bool, std::string> RlePattern::read(std::istream& input, Automat& automat, const size_t x, const size_t y,
+	const std::vector<std::string>& stateNames) {
+	auto setRun = [&automat](const size_t column, const size_t row, const size_t length, const size_t type) {
+		automat.setCellRun(column, row, length, type);
+	};
+	return read(input, automat.getCellTypes(), automat.width, automat.height, x, y, setRun, stateNames);
+}
+
+std::pair<bool, std::string> RlePattern::read(std::istream& input, const std::vector<CellType>& cellTypes,
+	const size_t gridWidth, const size_t gridHeight, const size_t x, const size_t y, const RunSetter& setRun,
+	const std::vector<std::string>& stateNames) {
+	RleHeader header;
+	auto [headerRead, headerError] = readHeader(input, header);
+	if (!headerRead) return { false, headerError };
+	const size_t width = header.width;
+	const size_t height = header.height;
+	if (x > gridWidth || width > gridWidth - x || y > gridHeight || height > gridHeight - y) {
+		return { false, "Pattern of size " + std::to_string(width) + "x" + std::to_string(height) + " doesn't fit into the grid" };
+	}
+
+	//cell type of each state, states without one are marked by typeCount
+	const size_t typeCount = cellTypes.size();
+	std::vector<size_t> stateToType(MAX_STATE + 1, typeCount);
+	const std::vector<std::string>& names = stateNames.empty() ? header.stateNames : stateNames;
+	if (names.empty()) {
+		for (size_t state = 0; state < stateToType.size() && state < typeCount; state++) stateToType[state] = state;
+	}
+	else {
+		std::unordered_map<std::string, size_t> nameToType;
+		for (size_t type = 0; type < typeCount; type++) nameToType.emplace(cellTypes[type].name, type);
+		for (size_t state = 0; state < names.size() && state <= MAX_STATE; state++) {
+			auto found = nameToType.find(names[state]);
+			if (found == nameToType.end()) return { false, "Cell type " + names[state] + " doesn't exist" };
+			stateToType[state] = found->second;
+		}
+	}
+
+	//cells not stored in the pattern are in state 0
+	const size_t emptyType = stateToType[0];
+	if (emptyType == typeCount) return { false, "State 0 has no cell type" };
+
+	size_t column = 0;
+	size_t row = 0;
+	//repeat count and state prefix read so far
+	size_t count = 0;
+	char prefix = 0;
+	const size_t maxCount = std::max(width, height);
+	auto clearRest = [&]() {
+		if (row >= height) return;
+		setRun(x + column, y + row, width - column, emptyType);
+	};
+	auto position = [&]() { return " at row " + std::to_string(row + 1) + " of the pattern"; };
+
+	//cells are decoded chunk by chunk without holding the whole pattern
+	std::vector<char> buffer(1 << 16);
+	bool done = false;
+	while (!done && input) {
+		input.read(buffer.data(), buffer.size());
+		const size_t read = static_cast<size_t>(input.gcount());
+		for (size_t i = 0; i < read && !done; i++) {
+			const char c = buffer[i];
+			if (c >= '0' && c <= '9') {
+				count = count * 10 + static_cast<size_t>(c - '0');
+				if (count > maxCount) return { false, "Run longer than the pattern" + position() };
+				continue;
+			}
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+			if (c == '!') {
+				done = true;
+				continue;
+			}
+			const size_t repeat = count ? count : 1;
+			count = 0;
+			if (c == '$') {
+				if (prefix) return { false, "Incomplete state" + position() };
+				clearRest();
+				for (size_t skipped = row + 1; skipped < row + repeat && skipped < height; skipped++) {
+					setRun(x, y + skipped, width, emptyType);
+				}
+				row += repeat;
+				column = 0;
+				continue;
+			}
+			if (c >= 'p' && c <= 'y' && !prefix) {
+				prefix = c;
+				//prefix and letter share the count
+				count = repeat == 1 ? 0 : repeat;
+				continue;
+			}
+			size_t state;
+			if ((c == 'b' || c == '.') && !prefix) state = 0;
+			else if (c == 'o' && !prefix) state = 1;
+			else if (c >= 'A' && c <= 'X') state = (prefix ? 24 * static_cast<size_t>(prefix - 'p' + 1) : 0) + static_cast<size_t>(c - 'A' + 1);
+			else return { false, "Invalid character '" + std::string(1, c) + "'" + position() };
+			prefix = 0;
+			if (state > MAX_STATE) return { false, "Invalid state" + position() };
+			if (row >= height || repeat > width - column) return { false, "Cells outside of the pattern size" + position() };
+			if (stateToType[state] == typeCount) return { false, "State " + std::to_string(state) + " has no cell type" + position() };
+			setRun(x + column, y + row, repeat, stateToType[state]);
+			column += repeat;
+		}
+	}
+	if (prefix || count) return { false, "Pattern ends with incomplete run" };
+	clearRest();
+	for (size_t skipped = row + 1; skipped < height; skipped++) setRun(x, y + skipped, width, emptyType);
+	return { true, "" };
+}
+
+void RlePattern::Writer::emit(const size_t repeat, const std::string& tag) {
+	std::string item = (repeat > 1 ? std::to_string(repeat) : "") + tag;
+	if (line.size() + item.size() > LINE_LENGTH) {
+		output << line << '\n';
+		line.clear();
+	}
+	line += item;
+}
+
+std::pair<bool, std::string> RlePattern::Writer::writeHeader(const Automat& automat, const size_t width, const size_t height) {
+	const std::vector<CellType>& cellTypes = automat.getCellTypes();
+	if (cellTypes.size() > MAX_STATE + 1) return { false, "Pattern format supports at most " + std::to_string(MAX_STATE + 1) + " cell types" };
+	twoStates = cellTypes.size() <= 2;
+
+	output << STATES_COMMENT;
+	for (const CellType& type : cellTypes) output << ' ' << type.name;
+	output << "\nx = " << width << ", y = " << height;
+	auto [binary, rule] = automat.getBinaryRule();
+	if (binary) {
+		output << ", rule = B";
+		for (unsigned int n = 0; n <= 8; n++) if ((rule.toOne[0] >> n) & 1) output << n;
+		output << "/S";
+		for (unsigned int n = 0; n <= 8; n++) if ((rule.toOne[1] >> n) & 1) output << n;
+	}
+	output << '\n';
+	return { true, "" };
+}
+
+void RlePattern::Writer::writeRow(const std::vector<size_t>& row) {
+	if (rows++ > 0) rowEnds++;
+	//cells after the last run of a row are cell type 0
+	size_t end = row.size();
+	while (end > 0 && row[end - 1] == 0) end--;
+	if (end == 0) return;
+	if (rowEnds > 0) emit(rowEnds, "$");
+	rowEnds = 0;
+	size_t column = 0;
+	while (column < end) {
+		const size_t state = row[column];
+		size_t next = column + 1;
+		while (next < end && row[next] == state) next++;
+		emit(next - column, stateTag(state, twoStates));
+		column = next;
+	}
+}
+
+std::pair<bool, std::string> RlePattern::Writer::finish() {
+	emit(1, "!");
+	output << line << '\n';
+	if (!output) return { false, "Can't write pattern" };
+	return { true, "" };
+}
+
+std::pair<bool, std::string> RlePattern::write(std::ostream& output, const Automat& automat,
+	const size_t x, const size_t y, const size_t width, const size_t height) {
+	Writer writer(output);
+	auto [headerWritten, headerError] = writer.writeHeader(automat, width, height);
+	if (!headerWritten) return { false, headerError };
+	std::vector<size_t> row(width);
+	for (size_t line = 0; line < height; line++) {
+		for (size_t column = 0; column < width; column++) row[column] = automat.getCellTypeAt(x + column, y + line);
+		writer.writeRow(row);
+	}
+	return writer.finish();
+}
@@ -0,0 +1,121 @@
+#ifndef AUTOMAT_RLE
+#define AUTOMAT_RLE
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <functional>
+
+#include "automat.hpp"
+
+/// @brief Header of a pattern in run length encoded format
+struct RleHeader {
+    /// @brief size of the pattern
+    size_t width = 0;
+    size_t height = 0;
+    /// @brief rule given in the header, empty if there is none
+    std::string rule;
+    /// @brief cell type names of the states in order, empty if the file doesn't list them
+    std::vector<std::string> stateNames;
+};
+
+/// @brief Reading and writing patterns in the run length encoded format used by Golly and other programs.
+/// Two state patterns use 'b' and 'o', others '.' for state 0 and 'A' to 'X', 'pA' to 'yO' for states 1 to 255.
+/// Cell type names are stored in a "#C CELAT states" comment, which other programs ignore.
+class RlePattern {
+private:
+    /// @brief comment listing the cell type names of the states
+    static constexpr const char* STATES_COMMENT = "#C CELAT states";
+    /// @brief highest state the format can express
+    static constexpr size_t MAX_STATE = 255;
+    /// @brief maximum length of lines written
+    static constexpr size_t LINE_LENGTH = 70;
+
+public:
+    /// @brief Receiver of decoded cells, called with (x, y, length, type) for each run of cells of one type in a row
+    using RunSetter = std::function<void(const size_t, const size_t, const size_t, const size_t)>;
+
+    /// @brief Encoder of a pattern given row by row, the cells don't have to be held in one automat
+    class Writer {
+    private:
+        /// @brief stream the pattern is written into
+        std::ostream& output;
+        /// @brief pattern uses 'b' and 'o'
+        bool twoStates = true;
+        /// @brief line being filled, written once the next item doesn't fit
+        std::string line;
+        /// @brief row ends not written yet, they are written only before the next non empty row
+        size_t rowEnds = 0;
+        /// @brief rows encoded so far
+        size_t rows = 0;
+
+        /// @brief Append run to the line
+        void emit(const size_t repeat, const std::string& tag);
+
+    public:
+        /// @param output stream the pattern is written into
+        explicit Writer(std::ostream& output) : output(output) {}
+
+        /// @brief Write cell type names and header line
+        /// @param automat automat defining the cell types and the rule, its grid is not used
+        /// @param width width of the pattern
+        /// @param height height of the pattern
+        /// @return std::pair (success, error_message), fails if the automat has more cell types than the format supports
+        std::pair<bool, std::string> writeHeader(const Automat& automat, const size_t width, const size_t height);
+
+        /// @brief Encode the next row of the pattern
+        /// @param row cell type of each cell of the row, as many as the width of the pattern
+        void writeRow(const std::vector<size_t>& row);
+
+        /// @brief Finish pattern after its last row
+        /// @return std::pair (success, error_message)
+        std::pair<bool, std::string> finish();
+    };
+
+    /// @brief Read comments and header line, the input is left at the first line of cells
+    /// @param input stream positioned at the start of the pattern
+    /// @param header the header
+    /// @return std::pair (success, error_message)
+    static std::pair<bool, std::string> readHeader(std::istream& input, RleHeader& header);
+
+    /// @brief Decode pattern directly into the grid, cells of the pattern's rectangle not set by it become cell type 0
+    /// @param input stream positioned at the start of the pattern
+    /// @param automat automat the pattern is written into
+    /// @param x column of the pattern's top left corner in the grid
+    /// @param y row of the pattern's top left corner in the grid
+    /// @param stateNames cell type names of the states in order, by default names listed in the file,
+    /// states are mapped to cell types by position when there are none
+    /// @return std::pair (success, error_message), cells decoded before an error stay in the grid
+    static std::pair<bool, std::string> read(std::istream& input, Automat& automat, const size_t x, const size_t y,
+        const std::vector<std::string>& stateNames = {});
+
+    /// @brief Decode pattern into runs of cells without holding the pattern or the grid, cells of the pattern's rectangle not set by it become cell type 0
+    /// @param input stream positioned at the start of the pattern
+    /// @param cellTypes cell types the states are mapped to
+    /// @param gridWidth width of the grid the pattern has to fit into
+    /// @param gridHeight height of the grid the pattern has to fit into
+    /// @param x column of the pattern's top left corner in the grid
+    /// @param y row of the pattern's top left corner in the grid
+    /// @param setRun receiver of the runs, called in the order of the pattern
+    /// @param stateNames cell type names of the states in order, by default names listed in the file,
+    /// states are mapped to cell types by position when there are none
+    /// @return std::pair (success, error_message), runs decoded before an error were passed to setRun
+    static std::pair<bool, std::string> read(std::istream& input, const std::vector<CellType>& cellTypes,
+        const size_t gridWidth, const size_t gridHeight, const size_t x, const size_t y, const RunSetter& setRun,
+        const std::vector<std::string>& stateNames = {});
+
+    /// @brief Encode a region of the grid, the cell type names are listed in a comment
+    /// @param output stream the pattern is written into
+    /// @param automat automat containing the region
+    /// @param x first column of the region
+    /// @param y first row of the region
+    /// @param width width of the region, the region has to lie inside the grid
+    /// @param height height of the region
+    /// @return std::pair (success, error_message), fails if the automat has more cell types than the format supports
+    static std::pair<bool, std::string> write(std::ostream& output, const Automat& automat,
+        const size_t x, const size_t y, const size_t width, const size_t height);
+};
+
+#endif // !AUTOMAT_RLE
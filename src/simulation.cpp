@@ -0,0 +1,187 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <utility>
+
+#include "simulation.hpp"
+
+Simulation::Simulation(std::unique_ptr<Automat> automat)
+	: automat(std::move(automat))
+{
+	//first frame is there before the worker starts
+	publish();
+	unpublished = false;
+	worker = std::thread(&Simulation::work, this);
+}
+
+Simulation::~Simulation() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+void Simulation::start() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = true;
+	}
+	wake.notify_one();
+}
+
+void Simulation::pause() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wake.notify_one();
+}
+
+bool Simulation::isRunning() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return running;
+}
+
+void Simulation::setInterval(const std::chrono::microseconds time) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		interval = time;
+	}
+	wake.notify_one();
+}
+
+void Simulation::setStopOnCycle(const bool enabled) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back([this, enabled]() {
+			stopOnCycle = enabled;
+			automat->setCycleDetection(enabled);
+		});
+	}
+	wake.notify_one();
+}
+
+void Simulation::setPopulationCounting(const bool enabled) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back([this, enabled]() {
+			countPopulation = enabled;
+			automat->setPopulationCounting(enabled);
+		});
+	}
+	wake.notify_one();
+}
+
+void Simulation::step(const unsigned long long generations) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingSteps += generations;
+	}
+	wake.notify_one();
+}
+
+void Simulation::edit(std::function<void(Automat&)> change) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back([this, change = std::move(change)]() { change(*automat); });
+	}
+	wake.notify_one();
+}
+
+void Simulation::replace(std::unique_ptr<Automat> newAutomat) {
+	//std::function has to be copyable, ownership is passed through shared_ptr
+	std::shared_ptr<std::unique_ptr<Automat>> holder = std::make_shared<std::unique_ptr<Automat>>(std::move(newAutomat));
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingSteps = 0;
+		commands.push_back([this, holder]() {
+			automat = std::move(*holder);
+			automat->setCycleDetection(stopOnCycle);
+			automat->setPopulationCounting(countPopulation);
+			generation = 0;
+		});
+	}
+	wake.notify_one();
+}
+
+void Simulation::setRules(const std::string& cellDefinitions, const std::string& rulesDefinitions, const bool overflowEdges) {
+	//grid of the compiled automat is not used, the smallest one keeps compiling cheap
+	std::shared_ptr<const Automat> compiled = std::make_shared<const Automat>(1, 1, cellDefinitions, rulesDefinitions, overflowEdges);
+	edit([compiled](Automat& automat) { automat.replaceRules(*compiled); });
+}
+
+void Simulation::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return running || (!busy && !unpublished && commands.empty() && pendingSteps == 0); });
+}
+
+void Simulation::work() {
+	auto nextEvolution = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		auto due = [this, &nextEvolution] {
+			return running && std::chrono::steady_clock::now() >= nextEvolution;
+		};
+		//while running the last generation is published together with the next one
+		auto ready = [this, &due] {
+			return stopping || !commands.empty() || pendingSteps > 0 || due() || (unpublished && !running);
+		};
+		if (running) wake.wait_until(lock, nextEvolution, ready);
+		else wake.wait(lock, ready);
+		if (stopping) return;
+
+		std::vector<std::function<void()>> batch;
+		batch.swap(commands);
+		bool evolve = pendingSteps > 0 || due();
+		if (pendingSteps > 0) pendingSteps--;
+		busy = true;
+		lock.unlock();
+
+		for (std::function<void()>& command : batch) command();
+		bool repeats = false;
+		if (evolve) {
+			automat->doOneEvolution();
+			generation++;
+			repeats = stopOnCycle && automat->getCyclePeriod().first;
+		}
+
+		lock.lock();
+		if (evolve) nextEvolution = std::chrono::steady_clock::now() + interval;
+		//settled grid would evolve through the same generations forever
+		if (repeats) running = false;
+		if (evolve || !batch.empty()) unpublished = true;
+		bool settled = !running && commands.empty() && pendingSteps == 0;
+		//frame not taken by the observer yet is only replaced by the last one before pausing
+		if (unpublished && (settled || !frames.isPending())) {
+			lock.unlock();
+			publish();
+			lock.lock();
+			unpublished = false;
+			settled = !running && commands.empty() && pendingSteps == 0;
+		}
+		busy = false;
+		if (settled) idle.notify_all();
+	}
+}
+
+void Simulation::publish() {
+	Frame& frame = frames.writeSlot();
+	frame.sequence = ++sequence;
+	frame.generation = generation;
+	frame.width = automat->width;
+	frame.height = automat->height;
+	frame.pixels.resize(frame.width * frame.height);
+	automat->exportPixels(frame.pixels.data(), 0, 0, frame.width, frame.height, frame.width);
+	frame.changed = automat->takeChangedRegions();
+	frame.period = automat->getCyclePeriod().second;
+	if (countPopulation) frame.population = automat->getPopulation();
+	else frame.population.clear();
+	frames.publish();
+}
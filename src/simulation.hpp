@@ -0,0 +1,149 @@
+#ifndef AUTOMAT_SIMULATION
+#define AUTOMAT_SIMULATION
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+#include "automat.hpp"
+#include "triplebuffer.hpp"
+
+/// @brief Generation of an automat published by the simulation thread
+struct Frame {
+    /// @brief increases by one with every published frame, a gap means frames were dropped
+    unsigned long long sequence = 0;
+    /// @brief amount of evolutions since the automat was set
+    unsigned long long generation = 0;
+    /// @brief size of the grid
+    size_t width = 0;
+    size_t height = 0;
+    /// @brief colours of cells one row after another, packed as in Automat::getPalette
+    std::vector<uint32_t> pixels;
+    /// @brief regions changed since the previous frame
+    std::vector<CellRegion> changed;
+    /// @brief period of the grid if it repeats an earlier generation, 0 otherwise or without cycle detection
+    unsigned long long period = 0;
+    /// @brief amount of cells of each type, empty without population counting
+    std::vector<uint64_t> population;
+};
+
+/// @brief Automat evolved on its own thread.
+/// Other threads control it through commands applied between generations
+/// and observe it through frames, only the newest frame is kept when the observer is slower.
+class Simulation {
+private:
+    /// @brief the automat, only accessed by the worker thread
+    std::unique_ptr<Automat> automat;
+    /// @brief frames passed from the worker to the observer
+    TripleBuffer<Frame> frames;
+
+    /// @brief guards the members below
+    std::mutex mutex;
+    /// @brief signals the worker that there is something to do
+    std::condition_variable wake;
+    /// @brief signals threads waiting for the worker to become idle
+    std::condition_variable idle;
+    /// @brief commands to be applied before the next generation
+    std::vector<std::function<void()>> commands;
+    /// @brief evolve continuously
+    bool running = false;
+    /// @brief single evolutions requested while not running
+    unsigned long long pendingSteps = 0;
+    /// @brief time between evolutions when running, zero for as fast as possible
+    std::chrono::microseconds interval{ 0 };
+    /// @brief worker is applying commands or evolving
+    bool busy = false;
+    /// @brief worker has to finish
+    bool stopping = false;
+    /// @brief automat changed since the last frame
+    bool unpublished = false;
+
+    /// @brief evolutions since the automat was set, only accessed by the worker thread
+    unsigned long long generation = 0;
+    /// @brief pause continuous evolution once the grid repeats, only accessed by the worker thread
+    bool stopOnCycle = false;
+    /// @brief count cells of each type for frames, only accessed by the worker thread
+    bool countPopulation = false;
+    /// @brief sequence number of the last frame, only accessed by the worker thread
+    unsigned long long sequence = 0;
+
+    /// @brief thread evolving the automat
+    std::thread worker;
+
+    /// @brief main loop of the worker thread
+    void work();
+
+    /// @brief export automat into a frame and publish it
+    void publish();
+
+public:
+    /// @brief Start worker thread, the simulation is paused
+    /// @param automat automat to be evolved
+    explicit Simulation(std::unique_ptr<Automat> automat);
+
+    /// @brief stop and join the worker thread
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    /// @brief evolve continuously
+    void start();
+
+    /// @brief stop evolving after the current generation
+    void pause();
+
+    /// @brief true if evolving continuously
+    bool isRunning();
+
+    /// @brief Set speed of continuous evolution
+    /// @param time time between evolutions, zero for as fast as possible
+    void setInterval(const std::chrono::microseconds time);
+
+    /// @brief Detect repeating grids and stop continuous evolution when the grid settled into a still life or oscillator.
+    /// Running again evolves at least one more generation, edits of cells start detection anew.
+    /// @param enabled false to evolve until paused
+    void setStopOnCycle(const bool enabled);
+
+    /// @brief Count cells of each type during evolutions and publish the counts with every frame
+    /// @param enabled false to stop counting
+    void setPopulationCounting(const bool enabled);
+
+    /// @brief Request evolutions while paused
+    /// @param generations amount of evolutions
+    void step(const unsigned long long generations);
+
+    /// @brief Change the automat between generations
+    /// @param change function applied to the automat on the worker thread
+    void edit(std::function<void(Automat&)> change);
+
+    /// @brief Evolve another automat from now on, generation count starts again
+    /// @param newAutomat the automat
+    void replace(std::unique_ptr<Automat> newAutomat);
+
+    /// @brief Replace cell definitions and rules between generations, the grid and generation count are kept.
+    /// Rules are compiled on the calling thread, the worker only converts the cells as described in Automat::replaceRules.
+    /// @param cellDefinitions string of cell definitions, separated by newline
+    /// @param rulesDefinitions string of rules, separated by newline
+    /// @param overflowEdges wrap around borders
+    /// @throws Automat::InvalidFormatException if definitions or rules are invalid, the automat is left unchanged
+    void setRules(const std::string& cellDefinitions, const std::string& rulesDefinitions, const bool overflowEdges);
+
+    /// @brief Wait until all commands and steps requested so far are done and published, returns immediately when running
+    void wait();
+
+    /// @brief Take the newest published frame if there is one, called by the observer
+    /// @return true if getFrame changed
+    bool updateFrame() { return frames.update(); }
+
+    /// @brief frame taken by the last updateFrame, empty before the first one
+    const Frame& getFrame() const { return frames.readSlot(); }
+};
+
+#endif // !AUTOMAT_SIMULATION
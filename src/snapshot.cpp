@@ -0,0 +1,337 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <memory>
+
+#include "automat.hpp"
+#include "snapshot.hpp"
+#include "mappedfile.hpp"
+
+namespace {
+
+/// @brief first bytes of every snapshot
+constexpr char SNAPSHOT_MAGIC[8] = { 'C', 'E', 'L', 'A', 'T', 'S', 'N', 'P' };
+
+/// @brief Collects runs of equal cells and writes them as varints into a file
+class RunWriter {
+private:
+	/// @brief encoded runs not written yet, flushed once it reaches FLUSH_SIZE
+	static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+	std::ofstream& file;
+	std::vector<uint8_t> buffer;
+	/// @brief run being collected
+	size_t state = 0;
+	uint64_t length = 0;
+	/// @brief bytes encoded so far
+	uint64_t encoded = 0;
+
+	void putVarint(uint64_t value) {
+		while (value >= 0x80) {
+			buffer.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back(static_cast<uint8_t>(value));
+	}
+
+	void endRun() {
+		if (length == 0) return;
+		putVarint(length);
+		putVarint(state);
+		if (buffer.size() >= FLUSH_SIZE) flush();
+	}
+
+	void flush() {
+		encoded += buffer.size();
+		file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+		buffer.clear();
+	}
+
+public:
+	explicit RunWriter(std::ofstream& file) : file(file) { buffer.reserve(FLUSH_SIZE + 20); }
+
+	/// @brief append cells of the same type
+	void add(const size_t cellType, const uint64_t count) {
+		if (count == 0) return;
+		if (cellType == state) {
+			length += count;
+			return;
+		}
+		endRun();
+		state = cellType;
+		length = count;
+	}
+
+	/// @brief write the last run and everything buffered
+	void finish() {
+		endRun();
+		flush();
+	}
+
+	/// @brief size of the encoded data, complete after finish
+	uint64_t size() const { return encoded; }
+};
+
+/// @brief Read unsigned LEB128 number
+/// @param data snapshot data
+/// @param size size of the data
+/// @param position position of the number, moved after it
+/// @param value the number
+/// @return false if the number is truncated or too large
+bool readVarint(const uint8_t* data, const size_t size, size_t& position, uint64_t& value) {
+	value = 0;
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		if (position >= size) return false;
+		const uint8_t byte = data[position++];
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return shift < 63 || byte <= 1;
+	}
+	return false;
+}
+
+/// @brief Copy raw rows into the haloed grid and check their cell types
+/// @tparam Cell integer type of cells
+/// @param cells first cell of the grid inside the halo
+/// @param stride distance between rows of the haloed grid
+/// @return false if a cell type is out of range
+template<typename Cell>
+bool copyRows(const uint8_t* data, Cell* cells, const size_t width, const size_t height, const size_t stride, const size_t stateCount) {
+	for (size_t y = 0; y < height; y++) {
+		Cell* row = cells + y * stride;
+		std::memcpy(row, data + y * width * sizeof(Cell), width * sizeof(Cell));
+		if (width > 0 && *std::max_element(row, row + width) >= stateCount) return false;
+	}
+	return true;
+}
+
+/// @brief Append rows of the haloed grid as runs
+/// @tparam Cell integer type of cells
+/// @param cells first cell of the grid inside the halo
+/// @param stride distance between rows of the haloed grid
+template<typename Cell>
+void encodeRows(RunWriter& runs, const Cell* cells, const size_t width, const size_t height, const size_t stride) {
+	for (size_t y = 0; y < height; y++) {
+		const Cell* row = cells + y * stride;
+		size_t x = 0;
+		while (x < width) {
+			size_t end = x + 1;
+			while (end < width && row[end] == row[x]) end++;
+			runs.add(row[x], end - x);
+			x = end;
+		}
+	}
+}
+
+} // namespace
+
+void Automat::saveSnapshot(const std::string& path, const bool compress) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) throw InvalidFormatException("Can't write " + path);
+
+	SnapshotHeader header{};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SnapshotHeader::VERSION;
+	header.byteOrder = SnapshotHeader::BYTE_ORDER_MARK;
+	header.width = width;
+	header.height = height;
+	header.overflowEdges = overflowEdges ? 1 : 0;
+	SnapshotEncoding encoding = compress ? SnapshotEncoding::runLength : (useBitGrid ? SnapshotEncoding::bits : SnapshotEncoding::raw);
+	header.encoding = static_cast<uint32_t>(encoding);
+	header.cellSize = encoding == SnapshotEncoding::raw ? static_cast<uint32_t>(cells.getCellSize()) : 0;
+	header.definitionsSize = cellDefinitions.size();
+	header.rulesSize = rulesDefinitions.size();
+	const uint64_t textEnd = sizeof(SnapshotHeader) + header.definitionsSize + header.rulesSize;
+	header.dataOffset = (textEnd + SnapshotHeader::DATA_ALIGNMENT - 1) / SnapshotHeader::DATA_ALIGNMENT * SnapshotHeader::DATA_ALIGNMENT;
+
+	//size of the data is known only after encoding, the header is written again at the end
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(cellDefinitions.data(), cellDefinitions.size());
+	file.write(rulesDefinitions.data(), rulesDefinitions.size());
+	const std::vector<char> padding(header.dataOffset - textEnd, 0);
+	file.write(padding.data(), padding.size());
+
+	if (encoding == SnapshotEncoding::raw) {
+		const size_t cellSize = cells.getCellSize();
+		const uint8_t* bytes = cells.data<uint8_t>();
+		for (size_t y = 0; y < height; y++) {
+			file.write(reinterpret_cast<const char*>(bytes + indexOf(0, y) * cellSize), width * cellSize);
+		}
+		header.dataSize = static_cast<uint64_t>(width) * height * cellSize;
+	}
+	else if (encoding == SnapshotEncoding::bits) {
+		const std::vector<uint64_t>& words = bitGrid.getWords();
+		file.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+		header.dataSize = words.size() * sizeof(uint64_t);
+	}
+	else {
+		RunWriter runs(file);
+		if (useBitGrid) {
+			const std::vector<uint64_t>& words = bitGrid.getWords();
+			const size_t wordsPerRow = bitGrid.getWordsPerRow();
+			for (size_t y = 0; y < height; y++) {
+				for (size_t i = 0; i < wordsPerRow; i++) {
+					const uint64_t word = words[y * wordsPerRow + i];
+					const size_t bits = std::min<size_t>(64, width - i * 64);
+					const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+					//uniform words are the common case in sparse patterns
+					if (word == 0 || word == mask) {
+						runs.add(word ? 1 : 0, bits);
+						continue;
+					}
+					for (size_t bit = 0; bit < bits; bit++) runs.add((word >> bit) & 1, 1);
+				}
+			}
+		}
+		else if (cells.getCellSize() == 1) encodeRows(runs, cells.data<uint8_t>() + indexOf(0, 0), width, height, getStride());
+		else encodeRows(runs, cells.data<uint16_t>() + indexOf(0, 0), width, height, getStride());
+		runs.finish();
+		header.dataSize = runs.size();
+	}
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	file.close();
+	if (!file) throw InvalidFormatException("Can't write " + path);
+}
+
+Automat Automat::loadSnapshot(const std::string& path) {
+	std::unique_ptr<MappedFile> file;
+	try {
+		file = std::make_unique<MappedFile>(path);
+	}
+	catch (const std::runtime_error& e) {
+		throw InvalidFormatException(e.what());
+	}
+	const uint8_t* bytes = file->data();
+	const size_t size = file->size();
+
+	SnapshotHeader header;
+	if (size < sizeof(header)) throw InvalidFormatException("Not a snapshot: " + path);
+	std::memcpy(&header, bytes, sizeof(header));
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) throw InvalidFormatException("Not a snapshot: " + path);
+	if (header.byteOrder != SnapshotHeader::BYTE_ORDER_MARK) throw InvalidFormatException("Snapshot was written with another byte order: " + path);
+	if (header.version != SnapshotHeader::VERSION) {
+		throw InvalidFormatException("Unsupported snapshot version " + std::to_string(header.version) + ": " + path);
+	}
+	//sizes are checked one by one so that corrupted values can't overflow
+	const uint64_t available = size - sizeof(header);
+	if (header.definitionsSize > available || header.rulesSize > available - header.definitionsSize
+		|| header.dataOffset < sizeof(header) + header.definitionsSize + header.rulesSize
+		|| header.dataOffset > size || header.dataSize > size - header.dataOffset) {
+		throw InvalidFormatException("Snapshot is truncated: " + path);
+	}
+	//haloed grid has to be addressable
+	const uint64_t maxSide = std::numeric_limits<size_t>::max() / 4;
+	const uint64_t halo = 2 * Neighbourhood::MAX_RADIUS;
+	if (header.width > maxSide || header.height > maxSide || (header.width + halo) > maxSide / (header.height + halo)) {
+		throw InvalidFormatException("Snapshot grid is too large: " + path);
+	}
+
+	const char* text = reinterpret_cast<const char*>(bytes + sizeof(header));
+	const std::string definitions(text, header.definitionsSize);
+	const std::string rules(text + header.definitionsSize, header.rulesSize);
+	Automat automat(header.width, header.height, definitions, rules, header.overflowEdges != 0);
+	auto [loaded, error] = automat.loadSnapshotData(header.encoding, header.cellSize, bytes + header.dataOffset, header.dataSize);
+	if (!loaded) throw InvalidFormatException(error + ": " + path);
+	return automat;
+}
+
+std::pair<bool, std::string> Automat::loadSnapshotData(const uint32_t encoding, const uint32_t cellSize,
+	const uint8_t* data, const size_t dataSize) {
+	const size_t cellCount = width * height;
+	const size_t stateCount = cellTypes.size();
+
+	if (encoding == static_cast<uint32_t>(SnapshotEncoding::raw)) {
+		if (cellSize != 1 && cellSize != 2) return { false, "Invalid cell size " + std::to_string(cellSize) };
+		if (cellSize < CellBuffer::cellSizeFor(stateCount)) return { false, "Cell size too small for the cell definitions" };
+		if (dataSize / cellSize != cellCount || dataSize % cellSize != 0) return { false, "Cell data doesn't match the grid size" };
+		if (!useBitGrid && cellSize == cells.getCellSize()) {
+			//rows are copied straight from the mapping into the haloed grid
+			bool valid = cellSize == 1
+				? copyRows(data, cells.data<uint8_t>() + indexOf(0, 0), width, height, getStride(), stateCount)
+				: copyRows(data, cells.data<uint16_t>() + indexOf(0, 0), width, height, getStride(), stateCount);
+			if (!valid) return { false, "Invalid cell type in cell data" };
+			tiles.markAll();
+			return { true, "" };
+		}
+		for (size_t i = 0; i < cellCount; i++) {
+			size_t cellType = data[i * cellSize];
+			if (cellSize == 2) {
+				uint16_t wide;
+				std::memcpy(&wide, data + i * 2, 2);
+				cellType = wide;
+			}
+			if (cellType >= stateCount) return { false, "Invalid cell type in cell data" };
+			if (cellType != 0) setCellTypeAt(i % width, i / width, cellType);
+		}
+		return { true, "" };
+	}
+
+	if (encoding == static_cast<uint32_t>(SnapshotEncoding::bits)) {
+		const size_t wordsPerRow = (width + 63) / 64;
+		if (dataSize / sizeof(uint64_t) != wordsPerRow * height || dataSize % sizeof(uint64_t) != 0) {
+			return { false, "Cell data doesn't match the grid size" };
+		}
+		if (useBitGrid) {
+			//data is aligned to 64 bytes within the page aligned mapping
+			if (!bitGrid.setWords(reinterpret_cast<const uint64_t*>(data))) return { false, "Cell data has bits set after the end of a row" };
+			return { true, "" };
+		}
+		for (size_t y = 0; y < height; y++) {
+			for (size_t x = 0; x < width; x++) {
+				uint64_t word;
+				std::memcpy(&word, data + (y * wordsPerRow + x / 64) * sizeof(uint64_t), sizeof(word));
+				if ((word >> (x % 64)) & 1) setCellTypeAt(x, y, 1);
+			}
+		}
+		return { true, "" };
+	}
+
+	if (encoding == static_cast<uint32_t>(SnapshotEncoding::runLength)) {
+		//new automat is filled with cell type 0, runs of it are skipped
+		size_t position = 0;
+		size_t index = 0;
+		while (position < dataSize) {
+			uint64_t length;
+			uint64_t cellType;
+			if (!readVarint(data, dataSize, position, length) || !readVarint(data, dataSize, position, cellType)) {
+				return { false, "Cell data is truncated" };
+			}
+			if (cellType >= stateCount) return { false, "Invalid cell type in cell data" };
+			if (length == 0 || length > cellCount - index) return { false, "Cell data doesn't match the grid size" };
+			if (cellType == 0) {
+				index += length;
+				continue;
+			}
+			while (length > 0) {
+				const size_t x = index % width;
+				const size_t y = index / width;
+				const size_t count = std::min<uint64_t>(length, width - x);
+				if (useBitGrid) {
+					for (size_t i = 0; i < count; i++) bitGrid.set(x + i, y, 1);
+				}
+				else if (cells.getCellSize() == 1) {
+					uint8_t* row = cells.data<uint8_t>() + indexOf(x, y);
+					std::fill(row, row + count, static_cast<uint8_t>(cellType));
+				}
+				else {
+					uint16_t* row = cells.data<uint16_t>() + indexOf(x, y);
+					std::fill(row, row + count, static_cast<uint16_t>(cellType));
+				}
+				index += count;
+				length -= count;
+			}
+		}
+		if (index != cellCount) return { false, "Cell data doesn't match the grid size" };
+		if (!useBitGrid) tiles.markAll();
+		return { true, "" };
+	}
+
+	return { false, "Unknown cell encoding " + std::to_string(encoding) };
+}
@@ -0,0 +1,53 @@
+#ifndef AUTOMAT_SNAPSHOT
+#define AUTOMAT_SNAPSHOT
+
+#include <cstdint>
+
+/// @brief How cells are stored in a snapshot
+enum class SnapshotEncoding : uint32_t {
+    /// @brief cell type indices row after row, SnapshotHeader::cellSize bytes each
+    raw = 0,
+    /// @brief two state cells packed as in BitGrid, ceil(width / 64) words of 8 bytes per row
+    bits = 1,
+    /// @brief runs of equal cells in row major order, each a varint length followed by a varint cell type index
+    runLength = 2
+};
+
+/// @brief Fixed size start of a snapshot file, followed by cell definitions, rules and the cell data.
+/// All numbers are stored in the byte order of the machine that wrote the file, which is recorded in byteOrder.
+struct SnapshotHeader {
+    /// @brief current version of the format
+    static constexpr uint32_t VERSION = 1;
+    /// @brief byteOrder as written by a machine of the same byte order
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    /// @brief alignment of the cell data within the file
+    static constexpr uint64_t DATA_ALIGNMENT = 64;
+
+    /// @brief "CELATSNP"
+    char magic[8];
+    /// @brief version of the format, files of other versions are rejected
+    uint32_t version;
+    /// @brief BYTE_ORDER_MARK as written by the machine that wrote the file
+    uint32_t byteOrder;
+    /// @brief size of the grid
+    uint64_t width;
+    uint64_t height;
+    /// @brief 1 if the grid wraps around borders
+    uint32_t overflowEdges;
+    /// @brief SnapshotEncoding of the cell data
+    uint32_t encoding;
+    /// @brief bytes per cell of raw cell data
+    uint32_t cellSize;
+    /// @brief zero
+    uint32_t reserved;
+    /// @brief length of the cell definitions and rules text following the header
+    uint64_t definitionsSize;
+    uint64_t rulesSize;
+    /// @brief position and size of the cell data in the file
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+static_assert(sizeof(SnapshotHeader) == 80, "snapshot header must not contain padding");
+
+#endif // !AUTOMAT_SNAPSHOT
@@ -0,0 +1,75 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(const size_t threadCount) {
+	for (size_t i = 1; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop() {
+	size_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+		runChunks();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::runChunks() {
+	while (true) {
+		size_t chunkBegin = nextChunk.fetch_add(grain);
+		if (chunkBegin >= end) return;
+		(*task)(chunkBegin, std::min(chunkBegin + grain, end));
+	}
+}
+
+void ThreadPool::parallelFor(const size_t begin, const size_t end, const size_t grain, const std::function<void(size_t, size_t)>& task) {
+	if (begin >= end) return;
+	//nothing to share, run on the calling thread
+	if (workers.empty() || end - begin <= grain) {
+		task(begin, end);
+		return;
+	}
+	std::lock_guard<std::mutex> job(jobMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		this->end = end;
+		this->grain = std::max<size_t>(grain, 1);
+		nextChunk = begin;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	runChunks();
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return busy == 0; });
+	this->task = nullptr;
+}
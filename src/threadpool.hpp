@@ -0,0 +1,69 @@
+#ifndef AUTOMAT_THREADPOOL
+#define AUTOMAT_THREADPOOL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/// @brief Persistent pool of worker threads running parallel loops
+class ThreadPool {
+private:
+    /// @brief worker threads, the thread calling parallelFor works too
+    std::vector<std::thread> workers;
+
+    /// @brief guards job state shared with workers
+    std::mutex mutex;
+    /// @brief serializes parallelFor calls from different threads
+    std::mutex jobMutex;
+    /// @brief wakes workers when a job is posted or the pool stops
+    std::condition_variable wake;
+    /// @brief wakes the caller when all workers finished the job
+    std::condition_variable done;
+
+    /// @brief current job
+    const std::function<void(size_t, size_t)>* task = nullptr;
+    /// @brief end of the range of the current job
+    size_t end = 0;
+    /// @brief size of chunks of the current job
+    size_t grain = 1;
+    /// @brief start of the next chunk to be taken
+    std::atomic<size_t> nextChunk{ 0 };
+    /// @brief incremented with every posted job
+    size_t generation = 0;
+    /// @brief amount of workers still working on the current job
+    size_t busy = 0;
+    /// @brief set when the pool is being destroyed
+    bool stopping = false;
+
+    /// @brief main loop of worker threads
+    void workerLoop();
+
+    /// @brief take chunks of the current job until none are left
+    void runChunks();
+
+public:
+    /// @brief Create pool
+    /// @param threadCount amount of threads working on a job including the calling thread
+    explicit ThreadPool(const size_t threadCount);
+
+    /// @brief Stops and joins all workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief amount of threads working on a job including the calling thread
+    size_t size() const { return workers.size() + 1; }
+
+    /// @brief Run task over range split into chunks, returns when all chunks are done
+    /// @param begin first index of the range
+    /// @param end index after the last one
+    /// @param grain size of chunks handed to threads
+    /// @param task function called with bounds [chunkBegin, chunkEnd) of each chunk
+    void parallelFor(const size_t begin, const size_t end, const size_t grain, const std::function<void(size_t, size_t)>& task);
+};
+
+#endif // !AUTOMAT_THREADPOOL
@@ -0,0 +1,50 @@
+#ifndef AUTOMAT_TRIPLEBUFFER
+#define AUTOMAT_TRIPLEBUFFER
+
+#include <array>
+#include <atomic>
+
+/// @brief Three slots passing values from one writer thread to one reader thread without locks.
+/// The writer fills its slot and publishes it, the reader takes the newest published slot.
+/// Values published while the reader was busy are replaced by newer ones and never read.
+/// @tparam T type of the values
+template<typename T>
+class TripleBuffer {
+private:
+    /// @brief bits of this->middle holding the slot index
+    static constexpr unsigned int INDEX_MASK = 3;
+    /// @brief bit of this->middle set if the middle slot was published and not taken yet
+    static constexpr unsigned int FRESH = 4;
+
+    /// @brief the values
+    std::array<T, 3> slots{};
+    /// @brief slot exchanged between writer and reader
+    std::atomic<unsigned int> middle{ 1 };
+    /// @brief slot owned by the writer
+    unsigned int back = 0;
+    /// @brief slot owned by the reader
+    unsigned int front = 2;
+
+public:
+    /// @brief slot to be filled by the writer
+    T& writeSlot() { return slots[back]; }
+
+    /// @brief make the writer's slot the newest value, the writer gets another slot
+    void publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK; }
+
+    /// @brief true if the newest value was not taken by the reader yet
+    bool isPending() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+    /// @brief Take the newest value if there is one, called by the reader
+    /// @return true if readSlot changed
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    /// @brief value taken by the last update
+    const T& readSlot() const { return slots[front]; }
+};
+
+#endif // !AUTOMAT_TRIPLEBUFFER